@@ -0,0 +1,248 @@
+#include "dragonfail.h"
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "animation.h"
+#include "config.h"
+#include "draw.h"
+#include "headless.h"
+#include "status.h"
+#include "timer.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// renders the greeter in memory for a number of frames and reports
+// the time, the cells presented and the allocations of each frame
+//
+// usage: ly-bench [frames]
+
+#define BENCH_FRAMES 1000
+#define BENCH_SEED 42
+
+struct lang lang;
+struct config config;
+
+// the allocator is wrapped at link time to count the calls
+static u64 allocs = 0;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size)
+{
+	++allocs;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+	++allocs;
+	return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+	++allocs;
+	return __real_realloc(ptr, size);
+}
+
+struct size
+{
+	u16 width;
+	u16 height;
+};
+
+static const struct size sizes[] =
+{
+	{80, 24},
+	{160, 48},
+	{320, 96},
+};
+
+// the cascade is restarted on a fresh screen once everything fell
+static bool cascade_landed = true;
+
+static void prepare_cascade(struct term_buf* buf)
+{
+	if (!cascade_landed)
+	{
+		return;
+	}
+
+	for (u16 y = 0; y < (buf->height / 2); ++y)
+	{
+		for (u16 x = 0; x < buf->width; ++x)
+		{
+			tb_change_cell(x, y, '#', config.fg, config.bg);
+		}
+	}
+
+	cascade_landed = false;
+}
+
+static void frame_cascade(struct term_buf* buf)
+{
+	cascade_landed = !cascade(buf);
+}
+
+static void frame_animate(struct term_buf* buf)
+{
+	buf->animation->step(buf->animation_state);
+	animate(buf);
+}
+
+static void frame_box(struct term_buf* buf)
+{
+	draw_box(buf);
+}
+
+static void frame_labels(struct term_buf* buf)
+{
+	draw_labels(buf);
+}
+
+static void frame_info_bar(struct term_buf* buf)
+{
+	draw_info_bar(buf);
+}
+
+// the hostname changes on every frame, long after the warm-up
+static u32 hostname_count = 0;
+
+static void frame_hostname(struct term_buf* buf)
+{
+	struct status status;
+
+	memcpy(&status, status_snapshot(&buf->status), sizeof (status));
+	snprintf(status.hostname, STATUS_HOSTNAME_LEN, "host%u", hostname_count);
+	++hostname_count;
+
+	status_inject(&buf->status, &status);
+	poll_status(buf, time_mono());
+	draw_info_line(buf);
+}
+
+// only the frame itself is timed, not the preparation or the diff
+static void bench_run(
+	char* name,
+	struct term_buf* buf,
+	void (*prepare)(struct term_buf*),
+	void (*frame)(struct term_buf*),
+	u32 frames)
+{
+	u64 ns = 0;
+	u64 cells = 0;
+	u64 frame_allocs = 0;
+
+	for (u32 i = 0; i < frames; ++i)
+	{
+		if (prepare != NULL)
+		{
+			prepare(buf);
+			tb_present();
+		}
+
+		u64 count = allocs;
+		u64 start = time_mono();
+		frame(buf);
+		ns += time_mono() - start;
+		frame_allocs += allocs - count;
+
+		tb_present();
+		cells += headless_changed();
+	}
+
+	printf(
+		"%-16s %4ux%-4u %10" PRIu64 " ns/frame %8" PRIu64 " cells/frame"
+		" %6.2f allocs/frame\n",
+		name,
+		buf->width,
+		buf->height,
+		ns / frames,
+		cells / frames,
+		(double) frame_allocs / frames);
+}
+
+static void bench_animations(struct term_buf* buf, u32 frames)
+{
+	const struct animation* animation;
+	char name[32];
+
+	for (u8 i = 0; (animation = animation_get(i)) != NULL; ++i)
+	{
+		buf->animation = animation;
+		buf->animation_state =
+			animation->init(buf->width, buf->height, BENCH_SEED);
+
+		if (dgn_catch())
+		{
+			buf->animation = NULL;
+			dgn_reset();
+			continue;
+		}
+
+		// renders are incremental, as between two full repaints
+		buf->full_damage = false;
+
+		snprintf(name, sizeof (name), "animate %s", animation->name);
+		bench_run(name, buf, NULL, frame_animate, frames);
+		animate_free(buf);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	u32 frames = BENCH_FRAMES;
+
+	if (argc > 1)
+	{
+		frames = strtoul(argv[1], NULL, 10);
+	}
+
+	if (frames == 0)
+	{
+		fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	dgn_init();
+	config_defaults();
+	lang_defaults();
+	config.seed = BENCH_SEED;
+
+	struct term_buf buf;
+	u8 sizes_len = (sizeof (sizes)) / (sizeof (struct size));
+
+	for (u8 i = 0; i < sizes_len; ++i)
+	{
+		headless_resize(sizes[i].width, sizes[i].height);
+		tb_set_clear_attributes(config.fg, config.bg_default);
+		tb_clear();
+
+		draw_init(&buf, NULL);
+		// positions the labels inside the box
+		draw_box(&buf);
+
+		bench_run("draw_box", &buf, NULL, frame_box, frames);
+		bench_run("draw_labels", &buf, NULL, frame_labels, frames);
+		bench_run("draw_info_bar", &buf, NULL, frame_info_bar, frames);
+		bench_run("hostname", &buf, NULL, frame_hostname, frames);
+		bench_animations(&buf, frames);
+
+		cascade_landed = true;
+		bench_run("cascade", &buf, prepare_cascade, frame_cascade, frames);
+
+		draw_free(&buf);
+	}
+
+	tb_shutdown();
+	lang_free();
+	config_free();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "headless.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// offscreen implementation of the termbox functions used by ly,
+// linked in place of termbox.a: tb_present compares the back buffer
+// to the front one instead of writing escape codes to a terminal
+
+static struct tb_cell* back = NULL;
+static struct tb_cell* front = NULL;
+static u16 width = 0;
+static u16 height = 0;
+static u32 clear_fg = 0;
+static u32 clear_bg = 0;
+static u64 changed = 0;
+
+static void cells_clear(struct tb_cell* cells)
+{
+	struct tb_cell blank = {' ', clear_fg, clear_bg};
+	u32 len = width * height;
+
+	for (u32 i = 0; i < len; ++i)
+	{
+		cells[i] = blank;
+	}
+}
+
+// the previous content is lost, like after a real resize
+void headless_resize(u16 new_width, u16 new_height)
+{
+	u32 len = new_width * new_height;
+
+	free(back);
+	free(front);
+	back = malloc((sizeof (struct tb_cell)) * len);
+	front = malloc((sizeof (struct tb_cell)) * len);
+
+	if ((back == NULL) || (front == NULL))
+	{
+		abort();
+	}
+
+	width = new_width;
+	height = new_height;
+	cells_clear(back);
+	cells_clear(front);
+}
+
+// cells which differed between the buffers at the last tb_present
+u64 headless_changed()
+{
+	return changed;
+}
+
+// without a terminal to query, the size comes from the environment
+static u16 env_size(char* name, u16 fallback)
+{
+	char* value = getenv(name);
+	long size = (value != NULL) ? strtol(value, NULL, 10) : 0;
+
+	return ((size > 0) && (size <= 0xffff)) ? size : fallback;
+}
+
+int tb_init(void)
+{
+	if (back == NULL)
+	{
+		headless_resize(env_size("COLUMNS", 80), env_size("LINES", 24));
+	}
+
+	return 0;
+}
+
+void tb_shutdown(void)
+{
+	free(back);
+	free(front);
+	back = NULL;
+	front = NULL;
+	width = 0;
+	height = 0;
+}
+
+int tb_width(void)
+{
+	return width;
+}
+
+int tb_height(void)
+{
+	return height;
+}
+
+void tb_clear(void)
+{
+	cells_clear(back);
+}
+
+void tb_set_clear_attributes(uint32_t fg, uint32_t bg)
+{
+	clear_fg = fg;
+	clear_bg = bg;
+}
+
+void tb_present(void)
+{
+	u32 len = width * height;
+	changed = 0;
+
+	for (u32 i = 0; i < len; ++i)
+	{
+		if (memcmp(&back[i], &front[i], sizeof (struct tb_cell)) != 0)
+		{
+			front[i] = back[i];
+			++changed;
+		}
+	}
+}
+
+void tb_set_cursor(int cx, int cy)
+{
+}
+
+void tb_put_cell(int x, int y, const struct tb_cell* cell)
+{
+	if ((x < 0) || (x >= width) || (y < 0) || (y >= height))
+	{
+		return;
+	}
+
+	back[(y * width) + x] = *cell;
+}
+
+void tb_change_cell(int x, int y, uint32_t ch, uint32_t fg, uint32_t bg)
+{
+	struct tb_cell cell = {ch, fg, bg};
+	tb_put_cell(x, y, &cell);
+}
+
+// clipped to the screen like termbox does
+void tb_blit(int x, int y, int w, int h, const struct tb_cell* cells)
+{
+	int skip_x = 0;
+	int skip_y = 0;
+
+	if (x < 0)
+	{
+		skip_x = -x;
+		x = 0;
+	}
+
+	if (y < 0)
+	{
+		skip_y = -y;
+		y = 0;
+	}
+
+	int copy_w = w - skip_x;
+	int copy_h = h - skip_y;
+
+	if (copy_w > (width - x))
+	{
+		copy_w = width - x;
+	}
+
+	if (copy_h > (height - y))
+	{
+		copy_h = height - y;
+	}
+
+	if ((copy_w <= 0) || (copy_h <= 0))
+	{
+		return;
+	}
+
+	for (int i = 0; i < copy_h; ++i)
+	{
+		memcpy(
+			&back[((y + i) * width) + x],
+			&cells[((skip_y + i) * w) + skip_x],
+			(sizeof (struct tb_cell)) * copy_w);
+	}
+}
+
+struct tb_cell* tb_cell_buffer(void)
+{
+	return back;
+}
+
+int tb_select_input_mode(int mode)
+{
+	return mode;
+}
+
+int tb_select_output_mode(int mode)
+{
+	return mode;
+}
+
+// there is no input: waiting for an event always fails
+int tb_peek_event(struct tb_event* event, int timeout)
+{
+	return 0;
+}
+
+int tb_poll_event(struct tb_event* event)
+{
+	return -1;
+}
+
+int utf8_char_length(char c)
+{
+	u8 byte = c;
+
+	if (byte < 0xc0)
+	{
+		return 1;
+	}
+
+	if (byte < 0xe0)
+	{
+		return 2;
+	}
+
+	if (byte < 0xf0)
+	{
+		return 3;
+	}
+
+	if (byte < 0xf8)
+	{
+		return 4;
+	}
+
+	if (byte < 0xfc)
+	{
+		return 5;
+	}
+
+	return 6;
+}
+
+int utf8_char_to_unicode(uint32_t* out, const char* c)
+{
+	static const u8 masks[6] = {0x7f, 0x1f, 0x0f, 0x07, 0x03, 0x01};
+
+	if (*c == '\0')
+	{
+		return TB_EOF;
+	}
+
+	int len = utf8_char_length(*c);
+	u32 result = c[0] & masks[len - 1];
+
+	for (int i = 1; i < len; ++i)
+	{
+		result = (result << 6) | (c[i] & 0x3f);
+	}
+
+	*out = result;
+
+	return len;
+}
+
+int utf8_unicode_to_char(char* out, uint32_t c)
+{
+	int len;
+	u8 first;
+
+	if (c < 0x80)
+	{
+		first = 0;
+		len = 1;
+	}
+	else if (c < 0x800)
+	{
+		first = 0xc0;
+		len = 2;
+	}
+	else if (c < 0x10000)
+	{
+		first = 0xe0;
+		len = 3;
+	}
+	else if (c < 0x200000)
+	{
+		first = 0xf0;
+		len = 4;
+	}
+	else if (c < 0x4000000)
+	{
+		first = 0xf8;
+		len = 5;
+	}
+	else
+	{
+		first = 0xfc;
+		len = 6;
+	}
+
+	for (int i = len - 1; i > 0; --i)
+	{
+		out[i] = (c & 0x3f) | 0x80;
+		c >>= 6;
+	}
+
+	out[0] = c | first;
+
+	return len;
+}
@@ -0,0 +1,9 @@
+#ifndef H_LY_HEADLESS
+#define H_LY_HEADLESS
+
+#include "ctypes.h"
+
+void headless_resize(u16 width, u16 height);
+u64 headless_changed();
+
+#endif
@@ -0,0 +1,536 @@
+#include "ctypes.h"
+
+#include "timer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__DragonFly__) || defined(__FreeBSD__)
+	#include <libutil.h>
+#else // linux
+	#include <pty.h>
+#endif
+
+// runs the real greeter on a pseudo-terminal for each animation, types
+// in the login field like a user would, and reports from the output
+// stream the time to the first frame, the delay between a key and its
+// echo and the bytes written per frame, which is what a serial or BMC
+// console pays for
+//
+// usage: ly-pty [binary] [seconds]
+
+#define PTY_WIDTH 80
+#define PTY_HEIGHT 24
+#define PTY_SECONDS 5
+#define PTY_KEYS 20
+// longest wait for the first frame or an echo
+#define PTY_TIMEOUT (5 * NSEC_PER_SEC)
+// output closer than this to the previous read belongs to the same frame
+#define PTY_BURST_GAP (4 * NSEC_PER_MSEC)
+#define PTY_LABEL "login"
+#define PTY_ESCAPE_LEN 32
+
+enum parser_states
+{
+	PARSER_TEXT,
+	PARSER_ESCAPE,
+	PARSER_CSI,
+	// the charset selection takes one more byte
+	PARSER_CHARSET,
+};
+
+// just enough of a terminal to know what termbox drew where
+struct screen
+{
+	u32 cells[PTY_WIDTH * PTY_HEIGHT];
+	u16 x;
+	u16 y;
+
+	enum parser_states state;
+	char escape[PTY_ESCAPE_LEN];
+	u8 escape_len;
+	u32 utf8;
+	u8 utf8_left;
+};
+
+struct session
+{
+	pid_t pid;
+	int master;
+	struct screen screen;
+
+	u64 bytes;
+	u64 bursts;
+	u64 last_read;
+};
+
+static const char* animations[] =
+{
+	"none",
+	"doom",
+	"matrix",
+};
+
+static void screen_clear(struct screen* screen, u32 from, u32 to)
+{
+	for (u32 i = from; (i < to) && (i < (PTY_WIDTH * PTY_HEIGHT)); ++i)
+	{
+		screen->cells[i] = ' ';
+	}
+}
+
+static void screen_put(struct screen* screen, u32 c)
+{
+	if ((screen->x < PTY_WIDTH) && (screen->y < PTY_HEIGHT))
+	{
+		screen->cells[(screen->y * PTY_WIDTH) + screen->x] = c;
+	}
+
+	++screen->x;
+}
+
+// only the sequences changing the content of the screen matter
+static void screen_csi(struct screen* screen, char final)
+{
+	u32 cursor = (screen->y * PTY_WIDTH) + screen->x;
+	unsigned row = 1;
+	unsigned col = 1;
+	char* params = screen->escape;
+
+	if (params[0] == '?')
+	{
+		return;
+	}
+
+	switch (final)
+	{
+		case 'H':
+		case 'f':
+		{
+			sscanf(params, "%u;%u", &row, &col);
+			screen->y = (row > 0) ? row - 1 : 0;
+			screen->x = (col > 0) ? col - 1 : 0;
+			break;
+		}
+		case 'J':
+		{
+			if (atoi(params) == 2)
+			{
+				screen_clear(screen, 0, PTY_WIDTH * PTY_HEIGHT);
+			}
+			else
+			{
+				screen_clear(screen, cursor, PTY_WIDTH * PTY_HEIGHT);
+			}
+
+			break;
+		}
+		case 'K':
+		{
+			screen_clear(screen, cursor, (screen->y + 1) * PTY_WIDTH);
+			break;
+		}
+	}
+}
+
+static void screen_feed(struct screen* screen, const char* buf, ssize_t len)
+{
+	for (ssize_t i = 0; i < len; ++i)
+	{
+		unsigned char c = buf[i];
+
+		switch (screen->state)
+		{
+			case PARSER_ESCAPE:
+			{
+				if (c == '[')
+				{
+					screen->state = PARSER_CSI;
+					screen->escape_len = 0;
+				}
+				else if ((c == '(') || (c == ')'))
+				{
+					screen->state = PARSER_CHARSET;
+				}
+				else
+				{
+					screen->state = PARSER_TEXT;
+				}
+
+				continue;
+			}
+			case PARSER_CHARSET:
+			{
+				screen->state = PARSER_TEXT;
+				continue;
+			}
+			case PARSER_CSI:
+			{
+				if ((c >= 0x40) && (c <= 0x7e))
+				{
+					screen->escape[screen->escape_len] = '\0';
+					screen_csi(screen, c);
+					screen->state = PARSER_TEXT;
+				}
+				else if (screen->escape_len < (PTY_ESCAPE_LEN - 1))
+				{
+					screen->escape[screen->escape_len] = c;
+					++screen->escape_len;
+				}
+
+				continue;
+			}
+			case PARSER_TEXT:
+			{
+				break;
+			}
+		}
+
+		if (screen->utf8_left > 0)
+		{
+			screen->utf8 = (screen->utf8 << 6) | (c & 0x3f);
+			--screen->utf8_left;
+
+			if (screen->utf8_left == 0)
+			{
+				screen_put(screen, screen->utf8);
+			}
+		}
+		else if (c == 0x1b)
+		{
+			screen->state = PARSER_ESCAPE;
+		}
+		else if (c == '\r')
+		{
+			screen->x = 0;
+		}
+		else if (c == '\n')
+		{
+			++screen->y;
+		}
+		else if (c == '\b')
+		{
+			screen->x = (screen->x > 0) ? screen->x - 1 : 0;
+		}
+		else if (c >= 0xf0)
+		{
+			screen->utf8 = c & 0x07;
+			screen->utf8_left = 3;
+		}
+		else if (c >= 0xe0)
+		{
+			screen->utf8 = c & 0x0f;
+			screen->utf8_left = 2;
+		}
+		else if (c >= 0xc0)
+		{
+			screen->utf8 = c & 0x1f;
+			screen->utf8_left = 1;
+		}
+		else if (c >= ' ')
+		{
+			screen_put(screen, c);
+		}
+	}
+}
+
+// looks for the text starting at the given column of a row,
+// or anywhere on the screen when row is negative; returns the
+// position following the text, or -1 when it is not shown
+static int screen_find(struct screen* screen, int row, u16 col, const char* s)
+{
+	u16 len = strlen(s);
+	u16 first = (row < 0) ? 0 : row;
+	u16 last = (row < 0) ? PTY_HEIGHT - 1 : row;
+
+	for (u16 y = first; y <= last; ++y)
+	{
+		for (u16 x = col; (x + len) <= PTY_WIDTH; ++x)
+		{
+			u32* cells = &screen->cells[(y * PTY_WIDTH) + x];
+			u16 i = 0;
+
+			while ((i < len) && (cells[i] == (unsigned char) s[i]))
+			{
+				++i;
+			}
+
+			if (i == len)
+			{
+				return (y * PTY_WIDTH) + x + len;
+			}
+		}
+	}
+
+	return -1;
+}
+
+// settings isolating the greeter from the machine it runs on
+static int config_write(char* path, const char* animation)
+{
+	int fd = mkstemp(path);
+
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	FILE* file = fdopen(fd, "w");
+
+	if (file == NULL)
+	{
+		close(fd);
+		return -1;
+	}
+
+	fprintf(file, "animate = %s\n", strcmp(animation, "none") ? "true" : "false");
+
+	if (strcmp(animation, "none") != 0)
+	{
+		fprintf(file, "animation = %s\n", animation);
+	}
+
+	fprintf(file, "console_dev = /dev/null\n");
+	fprintf(file, "default_input = 1\n");
+	fprintf(file, "load = false\n");
+	fprintf(file, "save = false\n");
+	fclose(file);
+
+	return 0;
+}
+
+static int session_start(struct session* session, char* binary, char* config)
+{
+	struct winsize size = {PTY_HEIGHT, PTY_WIDTH, 0, 0};
+
+	memset(session, 0, sizeof (struct session));
+	session->screen.state = PARSER_TEXT;
+	screen_clear(&session->screen, 0, PTY_WIDTH * PTY_HEIGHT);
+
+	session->pid = forkpty(&session->master, NULL, NULL, &size);
+
+	if (session->pid < 0)
+	{
+		return -1;
+	}
+
+	if (session->pid == 0)
+	{
+		setenv("TERM", "xterm", 1);
+		execl(binary, binary, "-c", config, NULL);
+		_exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+// reads what is available within the timeout, false once the greeter quit
+static bool session_read(struct session* session, int timeout)
+{
+	struct pollfd fd = {session->master, POLLIN, 0};
+	char buf[4096];
+
+	if (poll(&fd, 1, timeout) <= 0)
+	{
+		return true;
+	}
+
+	ssize_t len = read(session->master, buf, sizeof (buf));
+
+	if (len <= 0)
+	{
+		return false;
+	}
+
+	u64 now = time_mono();
+
+	if ((now - session->last_read) > PTY_BURST_GAP)
+	{
+		++session->bursts;
+	}
+
+	session->last_read = now;
+	session->bytes += len;
+	screen_feed(&session->screen, buf, len);
+
+	return true;
+}
+
+// nanoseconds until the text shows up, zero on timeout
+static u64 session_wait(
+	struct session* session,
+	int row,
+	u16 col,
+	const char* s,
+	int* found)
+{
+	u64 start = time_mono();
+	u64 now = start;
+
+	while ((now - start) < PTY_TIMEOUT)
+	{
+		*found = screen_find(&session->screen, row, col, s);
+
+		if (*found >= 0)
+		{
+			return now - start;
+		}
+
+		if (!session_read(session, 1))
+		{
+			break;
+		}
+
+		now = time_mono();
+	}
+
+	return 0;
+}
+
+static void session_stop(struct session* session)
+{
+	kill(session->pid, SIGTERM);
+
+	// the pty buffer must be drained for the greeter to exit
+	while (session_read(session, 100) && (waitpid(session->pid, NULL, WNOHANG) == 0));
+
+	waitpid(session->pid, NULL, 0);
+	close(session->master);
+}
+
+static void measure(char* binary, const char* animation, u32 seconds)
+{
+	char config[] = "/tmp/ly-pty-XXXXXX";
+	struct session session;
+	int found;
+
+	if (config_write(config, animation) < 0)
+	{
+		perror("ly-pty");
+		return;
+	}
+
+	if (session_start(&session, binary, config) < 0)
+	{
+		perror("ly-pty");
+		unlink(config);
+		return;
+	}
+
+	u64 first_frame = session_wait(&session, -1, 0, PTY_LABEL, &found);
+
+	if (first_frame == 0)
+	{
+		fprintf(stderr, "%s: no frame within the timeout\n", animation);
+		session_stop(&session);
+		unlink(config);
+		return;
+	}
+
+	// the login is echoed on the row of its label
+	int row = found / PTY_WIDTH;
+	u16 col = found % PTY_WIDTH;
+	char typed[PTY_KEYS + 1] = {0};
+	u64 echo_total = 0;
+	u64 echo_max = 0;
+	u8 keys = 0;
+
+	for (; keys < PTY_KEYS; ++keys)
+	{
+		typed[keys] = 'a' + (keys % 26);
+
+		if (write(session.master, &typed[keys], 1) != 1)
+		{
+			break;
+		}
+
+		u64 echo = session_wait(&session, row, col, typed, &found);
+
+		if (echo == 0)
+		{
+			fprintf(stderr, "%s: key %u not echoed\n", animation, keys);
+			break;
+		}
+
+		echo_total += echo;
+
+		if (echo > echo_max)
+		{
+			echo_max = echo;
+		}
+	}
+
+	// left alone, only the animation and the clock write anything
+	session.bytes = 0;
+	session.bursts = 0;
+
+	u64 start = time_mono();
+
+	while (((time_mono() - start) < (seconds * NSEC_PER_SEC))
+		&& session_read(&session, 10));
+
+	u64 frames = (session.bursts > 0) ? session.bursts : 1;
+
+	printf(
+		"%-8s %12.2f %12.1f %12.1f %12.1f %12llu %12llu\n",
+		animation,
+		first_frame / (double) NSEC_PER_MSEC,
+		(keys > 0) ? (echo_total / keys) / 1000.0 : 0.0,
+		echo_max / 1000.0,
+		session.bursts / (double) seconds,
+		(unsigned long long) (session.bytes / seconds),
+		(unsigned long long) (session.bytes / frames));
+
+	session_stop(&session);
+	unlink(config);
+}
+
+int main(int argc, char** argv)
+{
+	char* binary = "bin/ly";
+	u32 seconds = PTY_SECONDS;
+
+	if (argc > 1)
+	{
+		binary = argv[1];
+	}
+
+	if (argc > 2)
+	{
+		seconds = strtoul(argv[2], NULL, 10);
+	}
+
+	if (seconds == 0)
+	{
+		fprintf(stderr, "usage: %s [binary] [seconds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	printf(
+		"%-8s %12s %12s %12s %12s %12s %12s\n",
+		"anim",
+		"first ms",
+		"echo us",
+		"echo max us",
+		"frames/s",
+		"bytes/s",
+		"bytes/frame");
+
+	u8 animations_len = (sizeof (animations)) / (sizeof (char*));
+
+	for (u8 i = 0; i < animations_len; ++i)
+	{
+		measure(binary, animations[i], seconds);
+	}
+
+	return EXIT_SUCCESS;
+}
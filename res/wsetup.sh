@@ -51,4 +51,4 @@ case $SHELL in
     ;;
 esac
 
-exec $@
+exec "$@"
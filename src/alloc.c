@@ -0,0 +1,82 @@
+#include "ctypes.h"
+
+#include "alloc.h"
+
+#ifdef PROFILE_ALLOC
+
+#include <stddef.h>
+#include <stdlib.h>
+
+// glibc's own entry points, used by its malloc as well
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+
+static u64 allocs = 0;
+static u64 frees = 0;
+static bool forbidden = false;
+
+static void alloc_check()
+{
+	++allocs;
+
+	// the core dump points at the offending call
+	if (forbidden)
+	{
+		forbidden = false;
+		abort();
+	}
+}
+
+void* malloc(size_t size)
+{
+	alloc_check();
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size)
+{
+	alloc_check();
+	return __libc_calloc(count, size);
+}
+
+// counted as a new block replacing the old one
+void* realloc(void* ptr, size_t size)
+{
+	alloc_check();
+
+	if (ptr != NULL)
+	{
+		++frees;
+	}
+
+	return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr)
+{
+	if (ptr != NULL)
+	{
+		++frees;
+	}
+
+	__libc_free(ptr);
+}
+
+u64 alloc_count()
+{
+	return allocs;
+}
+
+u64 free_count()
+{
+	return frees;
+}
+
+void alloc_forbid(bool forbid)
+{
+	forbidden = forbid;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef H_LY_ALLOC
+#define H_LY_ALLOC
+
+#include "ctypes.h"
+
+// the allocator is only replaced with -DPROFILE_ALLOC (glibc only),
+// the counters then cover the libraries as well
+#ifdef PROFILE_ALLOC
+u64 alloc_count();
+u64 free_count();
+void alloc_forbid(bool forbid);
+#else
+#define alloc_count() 0
+#define free_count() 0
+#define alloc_forbid(forbid)
+#endif
+
+#endif
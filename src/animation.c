@@ -0,0 +1,50 @@
+#include "ctypes.h"
+
+#include "animation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the position in this list is the legacy numeric id of the animation
+static const struct animation* animations[] =
+{
+	&doom_animation,
+	&matrix_animation,
+};
+
+#define ANIMATIONS_LEN ((sizeof (animations)) / (sizeof (animations[0])))
+
+const struct animation* animation_get(u8 id)
+{
+	if (id >= ANIMATIONS_LEN)
+	{
+		return NULL;
+	}
+
+	return animations[id];
+}
+
+// looks an animation up by name, or by numeric id for older configs
+const struct animation* animation_find(char* name)
+{
+	for (u8 i = 0; i < ANIMATIONS_LEN; ++i)
+	{
+		if (strcmp(name, animations[i]->name) == 0)
+		{
+			return animations[i];
+		}
+	}
+
+	char* end;
+	long id = strtol(name, &end, 10);
+
+	if ((*name == '\0')
+		|| (*end != '\0')
+		|| (id < 0)
+		|| (id >= (long) ANIMATIONS_LEN))
+	{
+		return NULL;
+	}
+
+	return animations[id];
+}
@@ -0,0 +1,29 @@
+#ifndef H_LY_ANIMATION
+#define H_LY_ANIMATION
+
+#include "termbox.h"
+#include "ctypes.h"
+
+// an animation keeps its own state, returned by init and given back to
+// the other callbacks; init and resize throw when they fail to allocate
+struct animation
+{
+	char* name;
+	// simulation steps per second
+	u16 rate;
+
+	void* (*init)(u16 width, u16 height, u64 seed);
+	void (*step)(void* state);
+	// full is set when the cells were overwritten since the last render
+	void (*render)(void* state, struct tb_cell* cells, bool full);
+	void (*resize)(void* state, u16 width, u16 height);
+	void (*free)(void* state);
+};
+
+extern const struct animation doom_animation;
+extern const struct animation matrix_animation;
+
+const struct animation* animation_get(u8 id);
+const struct animation* animation_find(char* name);
+
+#endif
@@ -0,0 +1,52 @@
+#include "config.h"
+#include "clock.h"
+
+#include <locale.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+// the text is formatted at most once per second, whatever the number
+// of redraws; the status poller wakes the greeter up when it changes
+static char text[CLOCK_LEN];
+static time_t formatted = -1;
+static bool forced = false;
+
+void clock_init()
+{
+	setlocale(LC_TIME, config.clock_locale);
+	formatted = -1;
+}
+
+// an empty format hides the clock
+char* clock_text(time_t now)
+{
+	if (forced || (now == formatted))
+	{
+		return text;
+	}
+
+	formatted = now;
+	text[0] = '\0';
+
+	if (config.clock[0] != '\0')
+	{
+		struct tm* local = localtime(&now);
+
+		if ((local == NULL)
+			|| (strftime(text, CLOCK_LEN, config.clock, local) == 0))
+		{
+			text[0] = '\0';
+		}
+	}
+
+	return text;
+}
+
+// replays show the recorded text, whatever the time zone and locale
+void clock_force(const char* text_forced)
+{
+	strncpy(text, text_forced, CLOCK_LEN - 1);
+	text[CLOCK_LEN - 1] = '\0';
+	forced = true;
+}
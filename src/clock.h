@@ -0,0 +1,12 @@
+#ifndef H_LY_CLOCK
+#define H_LY_CLOCK
+
+#include <time.h>
+
+#define CLOCK_LEN 64
+
+void clock_init();
+char* clock_text(time_t now);
+void clock_force(const char* text);
+
+#endif
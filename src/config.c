@@ -50,6 +50,18 @@ static void config_handle_u16(void* data, char** pars, const int pars_count)
 	}
 }
 
+static void config_handle_u32(void* data, char** pars, const int pars_count)
+{
+	if (strcmp(*pars, "") == 0)
+	{
+		*((u32*)data) = 0;
+	}
+	else
+	{
+		*((u32*)data) = strtoul(*pars, NULL, 10);
+	}
+}
+
 void config_handle_str(void* data, char** pars, const int pars_count)
 {
 	if (*((char**)data) != NULL)
@@ -75,14 +87,19 @@ void lang_load()
 	// must be alphabetically sorted
 	struct configator_param map_no_section[] =
 	{
+		{"authenticating", &lang.authenticating, lang_handle},
 		{"capslock", &lang.capslock, lang_handle},
 		{"err_alloc", &lang.err_alloc, lang_handle},
+		{"err_auth_cancel", &lang.err_auth_cancel, lang_handle},
+		{"err_auth_timeout", &lang.err_auth_timeout, lang_handle},
 		{"err_bounds", &lang.err_bounds, lang_handle},
 		{"err_chdir", &lang.err_chdir, lang_handle},
 		{"err_console_dev", &lang.err_console_dev, lang_handle},
 		{"err_dgn_oob", &lang.err_dgn_oob, lang_handle},
 		{"err_domain", &lang.err_domain, lang_handle},
+		{"err_exec", &lang.err_exec, lang_handle},
 		{"err_hostname", &lang.err_hostname, lang_handle},
+		{"err_loop", &lang.err_loop, lang_handle},
 		{"err_mlock", &lang.err_mlock, lang_handle},
 		{"err_null", &lang.err_null, lang_handle},
 		{"err_pam", &lang.err_pam, lang_handle},
@@ -106,9 +123,12 @@ void lang_load()
 		{"err_perm_group", &lang.err_perm_group, lang_handle},
 		{"err_perm_user", &lang.err_perm_user, lang_handle},
 		{"err_pwnam", &lang.err_pwnam, lang_handle},
+		{"err_record", &lang.err_record, lang_handle},
 		{"err_user_gid", &lang.err_user_gid, lang_handle},
 		{"err_user_init", &lang.err_user_init, lang_handle},
 		{"err_user_uid", &lang.err_user_uid, lang_handle},
+		{"err_xauth", &lang.err_xauth, lang_handle},
+		{"err_xorg", &lang.err_xorg, lang_handle},
 		{"err_xsessions_dir", &lang.err_xsessions_dir, lang_handle},
 		{"err_xsessions_open", &lang.err_xsessions_open, lang_handle},
 		{"f1", &lang.f1, lang_handle},
@@ -122,7 +142,7 @@ void lang_load()
 		{"xinitrc", &lang.xinitrc, lang_handle},
 	};
 
-	uint16_t map_len[] = {45};
+	uint16_t map_len[] = {53};
 	struct configator_param* map[] =
 	{
 		map_no_section,
@@ -156,8 +176,9 @@ void config_load(const char *cfg_path)
 	struct configator_param map_no_section[] =
 	{
 		{"animate", &config.animate, config_handle_bool},
-		{"animation", &config.animation, config_handle_u8},
+		{"animation", &config.animation, config_handle_str},
 		{"asterisk", &config.asterisk, config_handle_char},
+		{"auth_timeout", &config.auth_timeout, config_handle_u16},
 		{"bar_fill", &config.bar_fill, config_handle_bool},
 		{"bg", &config.bg, config_handle_u16},
 		{"bg_bar", &config.bg_bar, config_handle_u16},
@@ -165,10 +186,15 @@ void config_load(const char *cfg_path)
 		{"bg_default", &config.bg_default, config_handle_u16},
 		{"blank_box", &config.blank_box, config_handle_bool},
 		{"blank_password", &config.blank_password, config_handle_bool},
+		{"clock", &config.clock, config_handle_str},
+		{"clock_locale", &config.clock_locale, config_handle_str},
 		{"console_dev", &config.console_dev, config_handle_str},
 		{"default_input", &config.default_input, config_handle_u8},
 		{"fg", &config.fg, config_handle_u16},
+		{"fps", &config.fps, config_handle_u16},
 		{"hide_borders", &config.hide_borders, config_handle_bool},
+		{"idle_blank", &config.idle_blank, config_handle_bool},
+		{"idle_timeout", &config.idle_timeout, config_handle_u16},
 		{"input_len", &config.input_len, config_handle_u8},
 		{"lang", &config.lang, config_handle_str},
 		{"load", &config.load, config_handle_bool},
@@ -180,9 +206,13 @@ void config_load(const char *cfg_path)
 		{"mcookie_cmd", &config.mcookie_cmd, config_handle_str},
 		{"min_refresh_delta", &config.min_refresh_delta, config_handle_u16},
 		{"path", &config.path, config_handle_str},
+		{"profile", &config.profile, config_handle_bool},
+		{"profile_alloc_warmup", &config.profile_alloc_warmup, config_handle_u16},
+		{"profile_file", &config.profile_file, config_handle_str},
 		{"restart_cmd", &config.restart_cmd, config_handle_str},
 		{"save", &config.save, config_handle_bool},
 		{"save_file", &config.save_file, config_handle_str},
+		{"seed", &config.seed, config_handle_u32},
 		{"service_name", &config.service_name, config_handle_str},
 		{"shutdown_cmd", &config.shutdown_cmd, config_handle_str},
 		{"term_reset_cmd", &config.term_reset_cmd, config_handle_str},
@@ -192,11 +222,12 @@ void config_load(const char *cfg_path)
 		{"waylandsessions", &config.waylandsessions, config_handle_str},
 		{"x_cmd", &config.x_cmd, config_handle_str},
 		{"x_cmd_setup", &config.x_cmd_setup, config_handle_str},
+		{"x_timeout", &config.x_timeout, config_handle_u16},
 		{"xauth_cmd", &config.xauth_cmd, config_handle_str},
 		{"xsessions", &config.xsessions, config_handle_str},
 	};
 
-	uint16_t map_len[] = {38};
+	uint16_t map_len[] = {50};
 	struct configator_param* map[] =
 	{
 		map_no_section,
@@ -216,14 +247,19 @@ void config_load(const char *cfg_path)
 
 void lang_defaults()
 {
+	lang.authenticating = strdup("authenticating");
 	lang.capslock = strdup("capslock");
 	lang.err_alloc = strdup("failed memory allocation");
+	lang.err_auth_cancel = strdup("login cancelled");
+	lang.err_auth_timeout = strdup("login timed out");
 	lang.err_bounds = strdup("out-of-bounds index");
 	lang.err_chdir = strdup("failed to open home folder");
 	lang.err_console_dev = strdup("failed to access console");
 	lang.err_dgn_oob = strdup("log message");
 	lang.err_domain = strdup("invalid domain");
+	lang.err_exec = strdup("failed to start the session");
 	lang.err_hostname = strdup("failed to get hostname");
+	lang.err_loop = strdup("failed to set up the event loop");
 	lang.err_mlock = strdup("failed to lock password memory");
 	lang.err_null = strdup("null pointer");
 	lang.err_pam = strdup("pam transaction failed");
@@ -247,9 +283,12 @@ void lang_defaults()
 	lang.err_perm_group = strdup("failed to downgrade group permissions");
 	lang.err_perm_user = strdup("failed to downgrade user permissions");
 	lang.err_pwnam = strdup("failed to get user info");
+	lang.err_record = strdup("failed to open the session record");
 	lang.err_user_gid = strdup("failed to set user GID");
 	lang.err_user_init = strdup("failed to initialize user");
 	lang.err_user_uid = strdup("failed to set user UID");
+	lang.err_xauth = strdup("failed to write the xauthority file");
+	lang.err_xorg = strdup("failed to start the X server");
 	lang.err_xsessions_dir = strdup("failed to find sessions folder");
 	lang.err_xsessions_open = strdup("failed to open sessions folder");
 	lang.f1 = strdup("F1 shutdown");
@@ -266,8 +305,9 @@ void lang_defaults()
 void config_defaults()
 {
 	config.animate = false;
-	config.animation = 0;
+	config.animation = strdup("doom");
 	config.asterisk = '*';
+	config.auth_timeout = 60;
 	config.bar_fill = false;
 	config.bg = 0;
 	config.bg_bar = 0;
@@ -275,10 +315,15 @@ void config_defaults()
 	config.bg_default = 0;
 	config.blank_box = true;
 	config.blank_password = false;
+	config.clock = strdup("%a %Y %b %d %H:%M:%S");
+	config.clock_locale = strdup("C");
 	config.console_dev = strdup("/dev/console");
 	config.default_input = PASSWORD_INPUT;
 	config.fg = 7;
+	config.fps = 30;
 	config.hide_borders = false;
+	config.idle_blank = false;
+	config.idle_timeout = 0;
 	config.input_len = 34;
 	config.lang = strdup("en");
 	config.load = true;
@@ -290,9 +335,13 @@ void config_defaults()
 	config.mcookie_cmd = strdup("/usr/bin/mcookie");
 	config.min_refresh_delta = 5;
 	config.path = strdup("/sbin:/bin:/usr/local/sbin:/usr/local/bin:/usr/bin:/usr/sbin");
+	config.profile = false;
+	config.profile_alloc_warmup = 0;
+	config.profile_file = strdup("/var/log/ly-profile.log");
 	config.restart_cmd = strdup("/sbin/shutdown -r now");
 	config.save = true;
 	config.save_file = strdup("/etc/ly/save");
+	config.seed = 0;
 	config.service_name = strdup("ly");
 	config.shutdown_cmd = strdup("/sbin/shutdown -a now");
 	config.term_reset_cmd = strdup("/usr/bin/tput reset");
@@ -302,20 +351,26 @@ void config_defaults()
 	config.waylandsessions = strdup("/usr/share/wayland-sessions");
 	config.x_cmd = strdup("/usr/bin/X");
 	config.x_cmd_setup = strdup(DATADIR "/xsetup.sh");
-	config.xauth_cmd = strdup("/usr/bin/xauth");
+	config.x_timeout = 10;
+	config.xauth_cmd = strdup("");
 	config.xsessions = strdup("/usr/share/xsessions");
 }
 
 void lang_free()
 {
+	free(lang.authenticating);
 	free(lang.capslock);
 	free(lang.err_alloc);
+	free(lang.err_auth_cancel);
+	free(lang.err_auth_timeout);
 	free(lang.err_bounds);
 	free(lang.err_chdir);
 	free(lang.err_console_dev);
 	free(lang.err_dgn_oob);
 	free(lang.err_domain);
+	free(lang.err_exec);
 	free(lang.err_hostname);
+	free(lang.err_loop);
 	free(lang.err_mlock);
 	free(lang.err_null);
 	free(lang.err_pam);
@@ -339,9 +394,12 @@ void lang_free()
 	free(lang.err_perm_group);
 	free(lang.err_perm_user);
 	free(lang.err_pwnam);
+	free(lang.err_record);
 	free(lang.err_user_gid);
 	free(lang.err_user_init);
 	free(lang.err_user_uid);
+	free(lang.err_xauth);
+	free(lang.err_xorg);
 	free(lang.err_xsessions_dir);
 	free(lang.err_xsessions_open);
 	free(lang.f1);
@@ -357,10 +415,14 @@ void lang_free()
 
 void config_free()
 {
+	free(config.animation);
+	free(config.clock);
+	free(config.clock_locale);
 	free(config.console_dev);
 	free(config.lang);
 	free(config.mcookie_cmd);
 	free(config.path);
+	free(config.profile_file);
 	free(config.restart_cmd);
 	free(config.save_file);
 	free(config.service_name);
@@ -11,14 +11,19 @@ enum INPUTS {
 
 struct lang
 {
+	char* authenticating;
 	char* capslock;
 	char* err_alloc;
+	char* err_auth_cancel;
+	char* err_auth_timeout;
 	char* err_bounds;
 	char* err_chdir;
 	char* err_console_dev;
 	char* err_dgn_oob;
 	char* err_domain;
+	char* err_exec;
 	char* err_hostname;
+	char* err_loop;
 	char* err_mlock;
 	char* err_null;
 	char* err_pam;
@@ -42,9 +47,12 @@ struct lang
 	char* err_perm_group;
 	char* err_perm_user;
 	char* err_pwnam;
+	char* err_record;
 	char* err_user_gid;
 	char* err_user_init;
 	char* err_user_uid;
+	char* err_xauth;
+	char* err_xorg;
 	char* err_xsessions_dir;
 	char* err_xsessions_open;
 	char* f1;
@@ -61,8 +69,9 @@ struct lang
 struct config
 {
 	bool animate;
-	u8 animation;
+	char* animation;
 	char asterisk;
+	u16 auth_timeout;
 	bool bar_fill;
 	u16 bg;
 	u16 bg_bar;
@@ -70,10 +79,15 @@ struct config
 	u16 bg_default;
 	bool blank_box;
 	bool blank_password;
+	char* clock;
+	char* clock_locale;
 	char* console_dev;
 	u8 default_input;
 	u16 fg;
+	u16 fps;
 	bool hide_borders;
+	bool idle_blank;
+	u16 idle_timeout;
 	u8 input_len;
 	char* lang;
 	bool load;
@@ -85,9 +99,13 @@ struct config
 	char* mcookie_cmd;
 	u16 min_refresh_delta;
 	char* path;
+	bool profile;
+	u16 profile_alloc_warmup;
+	char* profile_file;
 	char* restart_cmd;
 	bool save;
 	char* save_file;
+	u32 seed;
 	char* service_name;
 	char* shutdown_cmd;
 	char* term_reset_cmd;
@@ -97,6 +115,7 @@ struct config
 	char* waylandsessions;
 	char* x_cmd;
 	char* x_cmd_setup;
+	u16 x_timeout;
 	char* xauth_cmd;
 	char* xsessions;
 };
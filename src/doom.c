@@ -0,0 +1,315 @@
+#include "dragonfail.h"
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "animation.h"
+#include "doom.h"
+#include "prng.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+	&& defined(__GNUC__) \
+	&& !defined(__TINYC__)
+	#define DOOM_X86
+	#include <immintrin.h>
+#endif
+
+struct doom
+{
+	u8* heat;
+	u8* rand_buf;
+	u32 width;
+	u32 height;
+	struct prng prng;
+};
+
+static struct tb_cell fire[DOOM_STEPS] =
+{
+	{' ', 7, 0}, // black
+	{0x2591, 1, 0}, // red
+	{0x2592, 1, 0}, // red
+	{0x2593, 1, 0}, // red
+	{0x2588, 1, 0}, // red
+	{0x2591, 3, 1}, // yellow
+	{0x2592, 3, 1}, // yellow
+	{0x2593, 3, 1}, // yellow
+	{0x2588, 3, 1}, // yellow
+	{0x2591, 7, 3}, // white
+	{0x2592, 7, 3}, // white
+	{0x2593, 7, 3}, // white
+	{0x2588, 7, 3}, // white
+};
+
+// each cell of the row above takes the heat of a random neighbour
+// of the cell below it, in [-1;+2], cooled down by one every other time:
+// the two low bits of the random byte pick the neighbour and the cooling
+static void doom_cells(u8* dst, u8* src, u8* rand_buf, u32 width, u32 x, u32 end)
+{
+	i64 pos;
+	u8 random;
+	u8 heat;
+
+	for (; x < end; ++x)
+	{
+		random = rand_buf[x] & 3;
+		pos = (i64) x + random - 1;
+
+		if (pos < 0)
+		{
+			pos = 0;
+		}
+		else if (pos >= width)
+		{
+			pos = width - 1;
+		}
+
+		heat = src[pos];
+		dst[x] = (heat > (random & 1)) ? heat - (random & 1) : 0;
+	}
+}
+
+static void doom_row_scalar(u8* dst, u8* src, u8* rand_buf, u32 width)
+{
+	doom_cells(dst, src, rand_buf, width, 0, width);
+}
+
+#ifdef DOOM_X86
+__attribute__((target("sse2")))
+static void doom_row_sse2(u8* dst, u8* src, u8* rand_buf, u32 width)
+{
+	const __m128i mask = _mm_set1_epi8(3);
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i two = _mm_set1_epi8(2);
+	u32 x = 1;
+
+	doom_cells(dst, src, rand_buf, width, 0, 1);
+
+	// the neighbours of the last cell of a block must be in the row
+	for (; (x + 18) <= width; x += 16)
+	{
+		__m128i random = _mm_and_si128(
+			_mm_loadu_si128((__m128i*) (rand_buf + x)),
+			mask);
+
+		__m128i left = _mm_loadu_si128((__m128i*) (src + x - 1));
+		__m128i center = _mm_loadu_si128((__m128i*) (src + x));
+		__m128i right = _mm_loadu_si128((__m128i*) (src + x + 1));
+		__m128i far = _mm_loadu_si128((__m128i*) (src + x + 2));
+
+		__m128i heat = _mm_or_si128(
+			_mm_or_si128(
+				_mm_and_si128(_mm_cmpeq_epi8(random, _mm_setzero_si128()), left),
+				_mm_and_si128(_mm_cmpeq_epi8(random, one), center)),
+			_mm_or_si128(
+				_mm_and_si128(_mm_cmpeq_epi8(random, two), right),
+				_mm_and_si128(_mm_cmpeq_epi8(random, mask), far)));
+
+		heat = _mm_subs_epu8(heat, _mm_and_si128(random, one));
+		_mm_storeu_si128((__m128i*) (dst + x), heat);
+	}
+
+	doom_cells(dst, src, rand_buf, width, x, width);
+}
+
+__attribute__((target("avx2")))
+static void doom_row_avx2(u8* dst, u8* src, u8* rand_buf, u32 width)
+{
+	const __m256i mask = _mm256_set1_epi8(3);
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i two = _mm256_set1_epi8(2);
+	u32 x = 1;
+
+	doom_cells(dst, src, rand_buf, width, 0, 1);
+
+	// the neighbours of the last cell of a block must be in the row
+	for (; (x + 34) <= width; x += 32)
+	{
+		__m256i random = _mm256_and_si256(
+			_mm256_loadu_si256((__m256i*) (rand_buf + x)),
+			mask);
+
+		__m256i left = _mm256_loadu_si256((__m256i*) (src + x - 1));
+		__m256i center = _mm256_loadu_si256((__m256i*) (src + x));
+		__m256i right = _mm256_loadu_si256((__m256i*) (src + x + 1));
+		__m256i far = _mm256_loadu_si256((__m256i*) (src + x + 2));
+
+		__m256i heat = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_and_si256(_mm256_cmpeq_epi8(random, _mm256_setzero_si256()), left),
+				_mm256_and_si256(_mm256_cmpeq_epi8(random, one), center)),
+			_mm256_or_si256(
+				_mm256_and_si256(_mm256_cmpeq_epi8(random, two), right),
+				_mm256_and_si256(_mm256_cmpeq_epi8(random, mask), far)));
+
+		heat = _mm256_subs_epu8(heat, _mm256_and_si256(random, one));
+		_mm256_storeu_si256((__m256i*) (dst + x), heat);
+	}
+
+	doom_cells(dst, src, rand_buf, width, x, width);
+}
+#endif
+
+static void (*doom_row)(u8* dst, u8* src, u8* rand_buf, u32 width) =
+	doom_row_scalar;
+
+// picks the fastest row kernel supported by the cpu
+void doom_kernel_init()
+{
+	doom_row = doom_row_scalar;
+
+#ifdef DOOM_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		doom_row = doom_row_avx2;
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		doom_row = doom_row_sse2;
+	}
+#endif
+}
+
+// propagates the heat field one row up, from top to bottom so that
+// every row is read before being overwritten; the last row is the source
+void doom_spread(
+	u8* heat,
+	u8* rand_buf,
+	struct prng* prng,
+	u32 width,
+	u32 height)
+{
+	for (u32 y = 1; y < height; ++y)
+	{
+		prng_fill(prng, rand_buf, width);
+		doom_row(heat + ((y - 1) * width), heat + (y * width), rand_buf, width);
+	}
+}
+
+void doom_map(struct tb_cell* cells, u8* heat, u32 len)
+{
+	for (u32 i = 0; i < len; ++i)
+	{
+		cells[i] = fire[heat[i]];
+	}
+}
+
+// moves the heat field to the new size, anchored to the bottom
+// of the screen where the flames come from
+static void doom_resize(void* state, u16 width, u16 height) // throws
+{
+	struct doom* doom = state;
+	u32 len = (u32) width * height;
+
+	u8* heat = malloc(len);
+	u8* rand_buf = realloc(doom->rand_buf, width);
+
+	if (rand_buf != NULL)
+	{
+		doom->rand_buf = rand_buf;
+	}
+
+	if ((heat == NULL) || (rand_buf == NULL))
+	{
+		free(heat);
+		dgn_throw(DGN_ALLOC);
+		return;
+	}
+
+	memset(heat, 0, len);
+
+	if (doom->heat != NULL)
+	{
+		u32 copy_width = (width < doom->width) ? width : doom->width;
+		u32 copy_height = (height < doom->height) ? height : doom->height;
+
+		for (u32 y = 1; y <= copy_height; ++y)
+		{
+			memcpy(
+				heat + ((height - y) * width),
+				doom->heat + ((doom->height - y) * doom->width),
+				copy_width);
+		}
+	}
+
+	if (len > 0)
+	{
+		memset(heat + len - width, DOOM_STEPS - 1, width);
+	}
+
+	free(doom->heat);
+	doom->heat = heat;
+	doom->width = width;
+	doom->height = height;
+}
+
+static void doom_free(void* state)
+{
+	struct doom* doom = state;
+
+	free(doom->heat);
+	free(doom->rand_buf);
+	free(doom);
+}
+
+static void* doom_init(u16 width, u16 height, u64 seed) // throws
+{
+	struct doom* doom = malloc(sizeof (struct doom));
+
+	if (doom == NULL)
+	{
+		dgn_throw(DGN_ALLOC);
+		return NULL;
+	}
+
+	doom->heat = NULL;
+	doom->rand_buf = NULL;
+	doom->width = 0;
+	doom->height = 0;
+	prng_seed(&doom->prng, seed);
+
+	doom_resize(doom, width, height);
+
+	if (doom->heat == NULL)
+	{
+		doom_free(doom);
+		return NULL;
+	}
+
+	doom_kernel_init();
+
+	return doom;
+}
+
+static void doom_step(void* state)
+{
+	struct doom* doom = state;
+
+	doom_spread(
+		doom->heat,
+		doom->rand_buf,
+		&doom->prng,
+		doom->width,
+		doom->height);
+}
+
+static void doom_render(void* state, struct tb_cell* cells, bool full)
+{
+	struct doom* doom = state;
+
+	doom_map(cells, doom->heat, doom->width * doom->height);
+}
+
+const struct animation doom_animation =
+{
+	"doom",
+	60,
+	doom_init,
+	doom_step,
+	doom_render,
+	doom_resize,
+	doom_free,
+};
@@ -0,0 +1,20 @@
+#ifndef H_LY_DOOM
+#define H_LY_DOOM
+
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "prng.h"
+
+#define DOOM_STEPS 13
+
+void doom_kernel_init();
+void doom_spread(
+	u8* heat,
+	u8* rand_buf,
+	struct prng* prng,
+	u32 width,
+	u32 height);
+void doom_map(struct tb_cell* cells, u8* heat, u32 len);
+
+#endif
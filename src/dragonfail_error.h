@@ -20,6 +20,11 @@ enum dgn_error
 	DGN_USER_UID,
 	DGN_PAM,
 	DGN_HOSTNAME,
+	DGN_LOOP,
+	DGN_RECORD,
+	DGN_XORG,
+	DGN_XAUTH,
+	DGN_EXEC,
 
 	DGN_SIZE, // do not remove
 };
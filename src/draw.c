@@ -5,31 +5,37 @@
 #include "inputs.h"
 #include "utils.h"
 #include "config.h"
+#include "animation.h"
+#include "clock.h"
 #include "draw.h"
+#include "prng.h"
+#include "profile.h"
+#include "status.h"
+#include "timer.h"
 
 #include <ctype.h>
-#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
-#include <sys/stat.h>
-#include <unistd.h>
-
-#if defined(__DragonFly__) || defined(__FreeBSD__)
-	#include <sys/kbio.h>
-#else // linux
-	#include <linux/kd.h>
-#endif
-
-#define DOOM_STEPS 13
-#define DOOM_FRAMES 0
-#define MATRIX_FRAMES 5
 
-void draw_init(struct term_buf* buf)
+void draw_init(struct term_buf* buf, const struct status* seed)
 {
 	buf->width = tb_width();
 	buf->height = tb_height();
-	hostname(&buf->info_line);
+
+	status_init(&buf->status, time_mono(), seed);
+	buf->hostname = (char*) status_snapshot(&buf->status)->hostname;
+
+	if (buf->hostname[0] == '\0')
+	{
+		buf->hostname = NULL;
+	}
+
+	buf->info_line = buf->hostname;
+
+	if (status_snapshot(&buf->status)->console_error)
+	{
+		buf->info_line = lang.err_console_dev;
+	}
 
 	u16 len_login = strlen(lang.login);
 	u16 len_password = strlen(lang.password);
@@ -68,14 +74,34 @@ void draw_init(struct term_buf* buf)
 	buf->box_chars.left = '|';
 	buf->box_chars.right = '|';
 #endif
+
+	buf->animation = NULL;
+	buf->animation_state = NULL;
+	buf->animation_stale = false;
+
+	prng_seed(
+		&buf->cascade_prng,
+		(config.seed != 0) ? config.seed : time_mono());
+
+	buf->cache = NULL;
+	draw_cache(buf);
+
+	if (dgn_catch())
+	{
+		dgn_reset();
+	}
+
+	memset(buf->widgets, 0, sizeof (buf->widgets));
+	buf->full_damage = true;
+	buf->info_line_drawn = NULL;
 }
 
 void draw_free(struct term_buf* buf)
 {
-	if (config.animate)
-	{
-		free(buf->tmp_buf);
-	}
+	free(buf->cache);
+	status_free(&buf->status);
+
+	animate_free(buf);
 }
 
 void draw_box(struct term_buf* buf)
@@ -87,6 +113,11 @@ void draw_box(struct term_buf* buf)
 	buf->box_x = box_x;
 	buf->box_y = box_y;
 
+	buf->widgets[WIDGET_BOX].rect.x = box_x - 1;
+	buf->widgets[WIDGET_BOX].rect.y = box_y - 1;
+	buf->widgets[WIDGET_BOX].rect.w = box_x2 - box_x + 2;
+	buf->widgets[WIDGET_BOX].rect.h = box_y2 - box_y + 2;
+
 	if (!config.hide_borders)
 	{
 		// corners
@@ -166,233 +197,290 @@ void draw_box(struct term_buf* buf)
 	}
 }
 
-struct tb_cell* strn_cell(char* s, u16 len, u8 fg, u8 bg) // throws
+static u16 utf8_len(char* s)
 {
-	struct tb_cell* cells = malloc((sizeof (struct tb_cell)) * len);
-	char* s2 = s;
-	u32 c;
+	char* end = s + strlen(s);
+	u16 len = 0;
 
-	if (cells != NULL)
+	while (s < end)
 	{
-		for (u16 i = 0; i < len; ++i)
-		{
-			if ((s2 - s) >= len)
-			{
-				break;
-			}
+		s += utf8_char_length(*s);
+		++len;
+	}
 
-			s2 += utf8_char_to_unicode(&c, s2);
+	return len;
+}
 
-			cells[i].ch = c;
-			cells[i].bg = bg;
-			cells[i].fg = fg;
-		}
-	}
-	else
+// decodes the string in the given cells and returns the cell count
+static u16 cells_fill(struct tb_cell* cells, char* s, u16 fg, u16 bg)
+{
+	char* end = s + strlen(s);
+	u16 len = 0;
+	u32 c;
+
+	while (s < end)
 	{
-		dgn_throw(DGN_ALLOC);
+		s += utf8_char_to_unicode(&c, s);
+
+		cells[len].ch = c;
+		cells[len].fg = fg;
+		cells[len].bg = bg;
+		++len;
 	}
 
-	return cells;
+	return len;
 }
 
-struct tb_cell* str_cell(char* s, u8 fg, u8 bg) // throws
+// draws the string without going through an intermediate cell buffer,
+// cut after max cells
+static u16 draw_str(u16 x, u16 y, char* s, u16 max, u16 fg, u16 bg)
 {
-	return strn_cell(s, strlen(s), fg, bg);
+	char* end = s + strlen(s);
+	u16 len = 0;
+	u32 c;
+
+	while ((s < end) && (len < max))
+	{
+		s += utf8_char_to_unicode(&c, s);
+		tb_change_cell(x + len, y, c, fg, bg);
+		++len;
+	}
+
+	return len;
 }
 
-void draw_labels(struct term_buf* buf) // throws
+// builds the cells of the static strings once, in a single allocation;
+// must be called again when the language, colors or width change
+//
+// the hostname slot holds the longest hostname, one cell per byte at
+// worst, so a new hostname is refilled in place without allocating
+void draw_cache(struct term_buf* buf) // throws
 {
-	// login text
-	struct tb_cell* login = str_cell(lang.login, config.fg, config.bg);
+	u16 bg_bar = config.bg_bar_diff ? config.bg_bar : config.bg;
+	char* strings[CACHE_INFO_BAR] =
+	{
+		lang.login,
+		lang.password,
+		lang.numlock,
+		lang.capslock,
+		(buf->hostname != NULL) ? buf->hostname : "",
+	};
 
-	if (dgn_catch())
+	u32 total = buf->width + STATUS_HOSTNAME_LEN;
+
+	for (u8 i = 0; i < CACHE_HOSTNAME; ++i)
 	{
-		dgn_reset();
+		total += utf8_len(strings[i]);
 	}
-	else
+
+	free(buf->cache);
+	buf->cache = malloc((sizeof (struct tb_cell)) * total);
+	memset(buf->cached, 0, sizeof (buf->cached));
+
+	if (buf->cache == NULL)
 	{
-		tb_blit(
-			buf->box_x + config.margin_box_h,
-			buf->box_y + config.margin_box_v + 4,
-			strlen(lang.login),
-			1,
-			login);
-		free(login);
+		dgn_throw(DGN_ALLOC);
+		return;
 	}
 
-	// password text
-	struct tb_cell* password = str_cell(lang.password, config.fg, config.bg);
+	struct tb_cell* cells = buf->cache;
 
-	if (dgn_catch())
+	for (u8 i = 0; i < CACHE_INFO_BAR; ++i)
 	{
-		dgn_reset();
+		u16 bg = ((i == CACHE_NUMLOCK) || (i == CACHE_CAPSLOCK))
+			? bg_bar
+			: config.bg;
+
+		buf->cached[i].cells = cells;
+		buf->cached[i].len = cells_fill(cells, strings[i], config.fg, bg);
+		cells += (i == CACHE_HOSTNAME)
+			? STATUS_HOSTNAME_LEN
+			: buf->cached[i].len;
 	}
-	else
+
+	// the info bar spans the whole width, with f1 and f2 on its left
+	struct tb_cell blank = {' ', config.fg, bg_bar};
+	struct tb_cell* bar = cells;
+
+	for (u16 i = 0; i < buf->width; ++i)
 	{
-		tb_blit(
-			buf->box_x + config.margin_box_h,
-			buf->box_y + config.margin_box_v + 6,
-			strlen(lang.password),
-			1,
-			password);
-		free(password);
+		bar[i] = blank;
 	}
 
-	if (buf->info_line != NULL)
-	{
-		u16 len = strlen(buf->info_line);
-		struct tb_cell* info_cell = str_cell(buf->info_line, config.fg, config.bg);
+	u16 len_f1 = utf8_len(lang.f1);
+	u16 len_f2 = utf8_len(lang.f2);
 
-		if (dgn_catch())
-		{
-			dgn_reset();
-		}
-		else
-		{
-			tb_blit(
-				buf->box_x + ((buf->box_width - len) / 2),
-				buf->box_y + config.margin_box_v,
-				len,
-				1,
-				info_cell);
-			free(info_cell);
-		}
+	if ((len_f1 + 1 + len_f2) <= buf->width)
+	{
+		cells_fill(bar, lang.f1, config.fg, bg_bar);
+		cells_fill(bar + len_f1 + 1, lang.f2, config.fg, bg_bar);
 	}
+
+	buf->cached[CACHE_INFO_BAR].cells = bar;
+	buf->cached[CACHE_INFO_BAR].len = buf->width;
 }
 
-void draw_info_bar(struct term_buf* buf)
+// refills the hostname slot only, without leaving the arena
+static void draw_cache_hostname(struct term_buf* buf) // throws
 {
-	int width = tb_width();
-
-	struct tb_cell* f1 = str_cell(lang.f1, config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
+	struct cell_str* str = &buf->cached[CACHE_HOSTNAME];
 
-	if (dgn_catch())
-	{
-		dgn_reset();
-	}
-	else
+	if (buf->cache == NULL)
 	{
-		tb_blit(0, 0, strlen(lang.f1), 1, f1);
-		free(f1);
+		draw_cache(buf);
+		return;
 	}
 
-	struct tb_cell* f2 = str_cell(lang.f2, config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
+	str->len = cells_fill(
+		str->cells,
+		(buf->hostname != NULL) ? buf->hostname : "",
+		config.fg,
+		config.bg);
+}
 
-	if (dgn_catch())
+static void draw_cached(
+	struct term_buf* buf,
+	enum cache_entries entry,
+	u16 x,
+	u16 y)
+{
+	struct cell_str* str = &buf->cached[entry];
+
+	if (str->len > 0)
 	{
-		dgn_reset();
+		tb_blit(x, y, str->len, 1, str->cells);
 	}
-	else
+}
+
+void draw_labels(struct term_buf* buf)
+{
+	// login text
+	draw_cached(
+		buf,
+		CACHE_LOGIN,
+		buf->box_x + config.margin_box_h,
+		buf->box_y + config.margin_box_v + 4);
+
+	// password text
+	draw_cached(
+		buf,
+		CACHE_PASSWORD,
+		buf->box_x + config.margin_box_h,
+		buf->box_y + config.margin_box_v + 6);
+
+	struct rect* rect = &buf->widgets[WIDGET_LABELS].rect;
+	rect->x = buf->box_x + config.margin_box_h;
+	rect->y = buf->box_y + config.margin_box_v + 4;
+	rect->w = buf->labels_max_len;
+	rect->h = 3;
+}
+
+void draw_info_line(struct term_buf* buf)
+{
+	struct rect* rect = &buf->widgets[WIDGET_INFO_LINE].rect;
+	buf->info_line_drawn = buf->info_line;
+	rect->w = 0;
+
+	if (buf->info_line == NULL)
 	{
-		tb_blit(strlen(lang.f1) + 1, 0, strlen(lang.f2), 1, f2);
-		free(f2);
+		return;
 	}
 
-	struct tb_cell* empty = str_cell(" ", config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
+	u16 len;
 
-	if (dgn_catch())
+	if (buf->info_line == buf->hostname)
 	{
-		dgn_reset();
+		len = buf->cached[CACHE_HOSTNAME].len;
 	}
 	else
 	{
-		int i = strlen(lang.f1) + 1 + strlen(lang.f2);
-
-		tb_blit(strlen(lang.f1), 0, 1, 1, empty);
-		for(; i < width; ++i) {
-			tb_blit(i, 0, 1, 1, empty);
-		}
-
-		free(empty);
+		len = utf8_len(buf->info_line);
 	}
 
-	// TODO: Prevent null character from attaching to the end
-	char* time = (char*) malloc(25);
-	get_time(time);
-	time = (char*) realloc(time, 24);
+	// long pam messages are cut to the box
+	if (len > buf->box_width)
+	{
+		len = buf->box_width;
+	}
 
-	struct tb_cell* date_time = str_cell(time, config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
+	rect->x = buf->box_x + ((buf->box_width - len) / 2);
+	rect->y = buf->box_y + config.margin_box_v;
+	rect->w = len;
+	rect->h = 1;
 
-	if (dgn_catch())
+	if (buf->info_line == buf->hostname)
 	{
-		dgn_reset();
+		tb_blit(rect->x, rect->y, len, 1, buf->cached[CACHE_HOSTNAME].cells);
 	}
 	else
 	{
-		tb_blit(
-			buf->box_x + ((buf->box_width - 24) / 2),
-			0,
-			24,
-			1,
-			date_time);
-
-		free(date_time);
-		free(time);
+		draw_str(
+			rect->x,
+			rect->y,
+			buf->info_line,
+			len,
+			config.fg,
+			config.bg);
 	}
 }
 
-void draw_lock_state(struct term_buf* buf)
+void draw_info_bar(struct term_buf* buf)
 {
-	// get values
-	int fd = open(config.console_dev, O_RDONLY);
+	draw_cached(buf, CACHE_INFO_BAR, 0, 0);
 
-	if (fd < 0)
-	{
-		buf->info_line = lang.err_console_dev;
-		return;
-	}
+	struct rect* rect = &buf->widgets[WIDGET_INFO_BAR].rect;
+	rect->x = 0;
+	rect->y = 0;
+	rect->w = buf->width;
+	rect->h = 1;
+}
 
-	bool numlock_on;
-	bool capslock_on;
+void draw_clock(struct term_buf* buf)
+{
+	char* time = clock_text(status_snapshot(&buf->status)->clock);
+	u16 len = utf8_len(time);
 
-#if defined(__DragonFly__) || defined(__FreeBSD__)
-	int led;
-	ioctl(fd, KDGETLED, &led);
-	numlock_on = led & LED_NUM;
-	capslock_on = led & LED_CAP;
-#else // linux
-	char led;
-	ioctl(fd, KDGKBLED, &led);
-	numlock_on = led & K_NUMLOCK;
-	capslock_on = led & K_CAPSLOCK;
-#endif
+	if (len > buf->box_width)
+	{
+		len = buf->box_width;
+	}
 
-	close(fd);
+	struct rect* rect = &buf->widgets[WIDGET_CLOCK].rect;
+	rect->x = buf->box_x + ((buf->box_width - len) / 2);
+	rect->y = 0;
+	rect->w = len;
+	rect->h = 1;
+
+	draw_str(
+		rect->x,
+		rect->y,
+		time,
+		len,
+		config.fg,
+		config.bg_bar_diff ? config.bg_bar : config.bg);
+}
 
-	// print text
-	u16 pos_x = buf->width - strlen(lang.numlock);
+void draw_lock_state(struct term_buf* buf)
+{
+	const struct status* status = status_snapshot(&buf->status);
+	u16 pos_x = buf->width - buf->cached[CACHE_NUMLOCK].len;
 
-	if (numlock_on)
+	if (status->numlock)
 	{
-		struct tb_cell* numlock = str_cell(lang.numlock, config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
-
-		if (dgn_catch())
-		{
-			dgn_reset();
-		}
-		else
-		{
-			tb_blit(pos_x, 0, strlen(lang.numlock), 1, numlock);
-			free(numlock);
-		}
+		draw_cached(buf, CACHE_NUMLOCK, pos_x, 0);
 	}
 
-	pos_x -= strlen(lang.capslock) + 1;
+	pos_x -= buf->cached[CACHE_CAPSLOCK].len + 1;
 
-	if (capslock_on)
-	{
-		struct tb_cell* capslock = str_cell(lang.capslock, config.fg, config.bg_bar_diff ? config.bg_bar : config.bg);
+	struct rect* rect = &buf->widgets[WIDGET_LOCK_STATE].rect;
+	rect->x = pos_x;
+	rect->y = 0;
+	rect->w = buf->width - pos_x;
+	rect->h = 1;
 
-		if (dgn_catch())
-		{
-			dgn_reset();
-		}
-		else
-		{
-			tb_blit(pos_x, 0, strlen(lang.capslock), 1, capslock);
-			free(capslock);
-		}
+	if (status->capslock)
+	{
+		draw_cached(buf, CACHE_CAPSLOCK, pos_x, 0);
 	}
 }
 
@@ -428,11 +516,22 @@ void draw_desktop(struct desktop* target)
 			config.fg,
 			config.bg);
 	}
+
+	// erase what is left of a longer desktop name
+	for (u16 i = len + 2; i < (target->visible_len - 1); ++i)
+	{
+		tb_change_cell(
+			target->x + i,
+			target->y,
+			' ',
+			config.fg,
+			config.bg);
+	}
 }
 
 void draw_input(struct text* input)
 {
-	u16 len = strlen(input->text);
+	u16 len = input->end - input->visible_start;
 	u16 visible_len = input->visible_len;
 
 	if (len > visible_len)
@@ -440,26 +539,24 @@ void draw_input(struct text* input)
 		len = visible_len;
 	}
 
-	struct tb_cell* cells = strn_cell(input->visible_start, len, config.fg, config.bg);
-
-	if (dgn_catch())
+	for (u16 i = 0; i < len; ++i)
 	{
-		dgn_reset();
+		tb_change_cell(
+			input->x + i,
+			input->y,
+			input->visible_start[i],
+			config.fg,
+			config.bg);
 	}
-	else
-	{
-		tb_blit(input->x, input->y, len, 1, cells);
-		free(cells);
 
-		struct tb_cell c1 = {' ', config.fg, config.bg};
+	struct tb_cell c1 = {' ', config.fg, config.bg};
 
-		for (u16 i = input->end - input->visible_start; i < visible_len; ++i)
-		{
-			tb_put_cell(
-				input->x + i,
-				input->y,
-				&c1);
-		}
+	for (u16 i = len; i < visible_len; ++i)
+	{
+		tb_put_cell(
+			input->x + i,
+			input->y,
+			&c1);
 	}
 }
 
@@ -522,294 +619,407 @@ void position_input(
 	password->visible_len = len;
 }
 
-static void doom_init(struct term_buf* buf)
+void damage(struct term_buf* buf, enum widgets widget)
+{
+	buf->widgets[widget].dirty = true;
+}
+
+void damage_all(struct term_buf* buf)
 {
-	buf->init_width = buf->width;
-	buf->init_height = buf->height;
+	buf->full_damage = true;
+}
 
-	u16 tmp_len = buf->width * buf->height;
-	buf->tmp_buf = malloc(tmp_len);
-	tmp_len -= buf->width;
+static void draw_erase(struct rect* rect, u16 bg)
+{
+	struct tb_cell blank = {' ', config.fg, bg};
 
-	if (buf->tmp_buf == NULL)
+	for (u16 i = 0; i < rect->h; ++i)
 	{
-		dgn_throw(DGN_ALLOC);
+		for (u16 k = 0; k < rect->w; ++k)
+		{
+			tb_put_cell(rect->x + k, rect->y + i, &blank);
+		}
 	}
+}
 
-	memset(buf->tmp_buf, 0, tmp_len);
-	memset(buf->tmp_buf + tmp_len, DOOM_STEPS - 1, buf->width);
+static void input_rect(struct widget* widget, u16 x, u16 y, u16 len)
+{
+	widget->rect.x = x;
+	widget->rect.y = y;
+	widget->rect.w = len;
+	widget->rect.h = 1;
 }
 
-static void matrix_init(struct term_buf* buf)
+// redraws the widgets flagged as dirty since the last call
+// and returns false when the screen was left untouched
+bool draw_damaged(
+	struct term_buf* buf,
+	struct desktop* desktop,
+	struct text* login,
+	struct text* password)
 {
-	buf->init_width = buf->width;
-	buf->init_height = buf->height;
+	struct widget* widgets = buf->widgets;
+
+	if ((tb_width() != buf->width) || (tb_height() != buf->height))
+	{
+		buf->width = tb_width();
+		buf->height = tb_height();
+		buf->full_damage = true;
+
+		// the info bar spans the whole width
+		draw_cache(buf);
+
+		if (dgn_catch())
+		{
+			dgn_reset();
+		}
 
-	u16 tmp_len = buf->width * buf->height;
-	buf->tmp_buf = malloc(tmp_len);
+		animate_resize(buf);
+
+		if (dgn_catch())
+		{
+			dgn_reset();
+		}
+	}
 
-	if (buf->tmp_buf == NULL)
+	if (buf->info_line != buf->info_line_drawn)
 	{
-		dgn_throw(DGN_ALLOC);
+		widgets[WIDGET_INFO_LINE].dirty = true;
 	}
 
-	memset(buf->tmp_buf, 0, tmp_len);
-}
+	// full repaints start from a blank screen, and the animation
+	// overwrites every cell so both require all the widgets on top
+	bool erase = !buf->full_damage && !widgets[WIDGET_ANIMATION].dirty;
 
-void animate_init(struct term_buf* buf)
-{
-	if (config.animate)
+	if (buf->full_damage)
 	{
-		switch(config.animation)
+		tb_clear();
+	}
+
+	if (!erase)
+	{
+		for (u8 i = 0; i < WIDGET_COUNT; ++i)
 		{
-			case 1:
-			{
-				matrix_init(buf);
-				break;
-			}
-			default:
-			{
-				doom_init(buf);
-				break;
-			}
+			widgets[i].dirty = true;
 		}
 	}
-}
 
-static void doom(struct term_buf* term_buf)
-{
-	static struct tb_cell fire[DOOM_STEPS] =
-	{
-		{' ', 7, 0}, // black
-		{0x2591, 1, 0}, // red
-		{0x2592, 1, 0}, // red
-		{0x2593, 1, 0}, // red
-		{0x2588, 1, 0}, // red
-		{0x2591, 3, 1}, // yellow
-		{0x2592, 3, 1}, // yellow
-		{0x2593, 3, 1}, // yellow
-		{0x2588, 3, 1}, // yellow
-		{0x2591, 7, 3}, // white
-		{0x2592, 7, 3}, // white
-		{0x2593, 7, 3}, // white
-		{0x2588, 7, 3}, // white
-	};
+	bool drawn = false;
+
+	for (u8 i = 0; i < WIDGET_COUNT; ++i)
+	{
+		drawn = drawn || widgets[i].dirty;
+	}
 
-	u16 src;
-	u16 random;
-	u16 dst;
+	if (!drawn)
+	{
+		return false;
+	}
 
-	u16 w = term_buf->init_width;
-	u8* tmp = term_buf->tmp_buf;
+	u16 bg_box = config.blank_box ? config.bg : config.bg_default;
+	u16 bg_bar = config.bg_bar_diff ? config.bg_bar : config.bg;
 
-	if ((term_buf->width != term_buf->init_width) || (term_buf->height != term_buf->init_height))
+	if (widgets[WIDGET_ANIMATION].dirty)
 	{
-		return;
+		PROFILED(PROFILE_ANIMATE, animate(buf));
 	}
 
-	struct tb_cell* buf = tb_cell_buffer();
+	// the box background covers everything inside it
+	if (widgets[WIDGET_BOX].dirty)
+	{
+		PROFILED(PROFILE_BOX, draw_box(buf));
+		PROFILED(
+			PROFILE_POSITION_INPUT,
+			position_input(buf, desktop, login, password));
+
+		widgets[WIDGET_LABELS].dirty = true;
+		widgets[WIDGET_INFO_LINE].dirty = true;
+		widgets[WIDGET_DESKTOP].dirty = true;
+		widgets[WIDGET_LOGIN].dirty = true;
+		widgets[WIDGET_PASSWORD].dirty = true;
+	}
+
+	if (widgets[WIDGET_LABELS].dirty)
+	{
+		PROFILED(PROFILE_LABELS, draw_labels(buf));
+	}
 
-	for (u16 x = 0; x < w; ++x)
+	if (widgets[WIDGET_INFO_LINE].dirty)
 	{
-		for (u16 y = 1; y < term_buf->init_height; ++y)
+		if (erase)
 		{
-			src = y * w + x;
-			random = ((rand() % 7) & 3);
-			dst = src - random + 1;
+			draw_erase(&widgets[WIDGET_INFO_LINE].rect, bg_box);
+			buf->animation_stale = true;
+		}
 
-			if (w > dst)
-			{
-				dst = 0;
-			}
-			else
-			{
-				dst -= w;
-			}
+		PROFILED(PROFILE_INFO_LINE, draw_info_line(buf));
+	}
 
-			tmp[dst] = tmp[src] - (random & 1);
+	// the info bar background covers the clock and lock state
+	if (widgets[WIDGET_INFO_BAR].dirty)
+	{
+		PROFILED(PROFILE_INFO_BAR, draw_info_bar(buf));
 
-			if (tmp[dst] > 12)
-			{
-				tmp[dst] = 0;
-			}
+		widgets[WIDGET_CLOCK].dirty = true;
+		widgets[WIDGET_LOCK_STATE].dirty = true;
+	}
+
+	if (widgets[WIDGET_CLOCK].dirty)
+	{
+		// the length of the clock depends on its format
+		char* time = clock_text(status_snapshot(&buf->status)->clock);
+		u16 len = utf8_len(time);
+
+		if (len > buf->box_width)
+		{
+			len = buf->box_width;
+		}
 
-			buf[dst] = fire[tmp[dst]];
-			buf[src] = fire[tmp[src]];
+		if (erase && (len != widgets[WIDGET_CLOCK].rect.w))
+		{
+			draw_erase(&widgets[WIDGET_CLOCK].rect, bg_bar);
+			buf->animation_stale = true;
 		}
+
+		PROFILED(PROFILE_CLOCK, draw_clock(buf));
 	}
-}
 
-static void matrix(struct term_buf* term_buf)
-{
-	u16 src;
-	u16 random;
-	u16 dst;
+	if (widgets[WIDGET_LOCK_STATE].dirty)
+	{
+		if (erase)
+		{
+			draw_erase(&widgets[WIDGET_LOCK_STATE].rect, bg_bar);
+			buf->animation_stale = true;
+		}
 
-	u16 w = term_buf->init_width;
-	u8* tmp = term_buf->tmp_buf;
+		PROFILED(PROFILE_LOCK_STATE, draw_lock_state(buf));
+	}
 
-	if ((term_buf->width != term_buf->init_width) || (term_buf->height != term_buf->init_height))
+	if (widgets[WIDGET_DESKTOP].dirty)
 	{
-		return;
+		PROFILED(PROFILE_DESKTOP, draw_desktop(desktop));
+		input_rect(
+			&widgets[WIDGET_DESKTOP],
+			desktop->x,
+			desktop->y,
+			desktop->visible_len);
 	}
 
-	struct tb_cell* buf = tb_cell_buffer();
+	if (widgets[WIDGET_LOGIN].dirty)
+	{
+		PROFILED(PROFILE_LOGIN, draw_input(login));
+		input_rect(
+			&widgets[WIDGET_LOGIN],
+			login->x,
+			login->y,
+			login->visible_len);
+	}
 
-	for (u16 x = 0; x < w; ++x)
+	if (widgets[WIDGET_PASSWORD].dirty)
 	{
-		for (u16 y = term_buf->init_height - 1; y > 0; --y)
-		{
-			dst = y * w + x;
-			src = dst - w;
+		PROFILED(PROFILE_PASSWORD, draw_input_mask(password));
+		input_rect(
+			&widgets[WIDGET_PASSWORD],
+			password->x,
+			password->y,
+			password->visible_len);
+	}
 
-			if (tmp[src])
-			{
-				if (tmp[dst] & 128)
-				{
-					tmp[dst] = tmp[dst] & 127;
-				}
-				else if (!tmp[dst])
-				{
-					tmp[dst] = (rand() % 94) + 161;
-				}
-
-				buf[dst].ch = tmp[dst] & 127;
-				buf[dst].fg = (tmp[dst] & 128) ? 7 : 2;
-				buf[dst].bg = 0;
-			}
-			else
-			{
-				if (tmp[dst])
-				{
-					tmp[dst] = 0;
-				}
-
-				buf[dst].ch = ' ';
-				buf[dst].fg = 7;
-				buf[dst].bg = 0;
-			}
-		}
+	for (u8 i = 0; i < WIDGET_COUNT; ++i)
+	{
+		widgets[i].dirty = false;
+	}
 
-		random = ((rand() % 32) & 30);
+	buf->full_damage = false;
 
-		if (random)
-		{
-			if (tmp[x + w])
-			{
-				random = (rand() % 94) + 33;
-				tmp[x] = random;
+	return true;
+}
 
-				buf[x].ch = random;
-				buf[x].fg = 2;
-				buf[x].bg = 0;
-			}
-			else
-			{
-				tmp[x] = 0;
+// damages the widgets showing the status values which changed,
+// and returns the mask of their sources
+u32 poll_status(struct term_buf* buf, u64 now)
+{
+	u32 changed = status_poll(&buf->status, now);
+	const struct status* status = status_snapshot(&buf->status);
 
-				buf[x].ch = ' ';
-				buf[x].fg = 7;
-				buf[x].bg = 0;
-			}
+	if (changed & (1 << STATUS_LEDS))
+	{
+		damage(buf, WIDGET_LOCK_STATE);
+
+		if (status->console_error)
+		{
+			buf->info_line = lang.err_console_dev;
+			damage(buf, WIDGET_INFO_LINE);
 		}
-		else
+		else if (buf->info_line == lang.err_console_dev)
 		{
-			if (tmp[x + w])
-			{
-				tmp[x] = 0;
+			// the console is back, the message is stale
+			buf->info_line = buf->hostname;
+			damage(buf, WIDGET_INFO_LINE);
+		}
+	}
 
-				buf[x].ch = ' ';
-				buf[x].fg = 7;
-				buf[x].bg = 0;
-			}
-			else
-			{
-				random = (rand() % 94) + 161;
-				tmp[x] = random;
+	if (changed & (1 << STATUS_CLOCK))
+	{
+		damage(buf, WIDGET_CLOCK);
+	}
 
-				buf[x].ch = random & 127;
-				buf[x].fg = 7;
-				buf[x].bg = 0;
-			}
+	if (changed & (1 << STATUS_HOSTNAME))
+	{
+		bool shown = (buf->info_line == NULL)
+			|| (buf->info_line == buf->hostname);
+
+		buf->hostname = (status->hostname[0] != '\0')
+			? (char*) status->hostname
+			: NULL;
+
+		if (shown)
+		{
+			buf->info_line = buf->hostname;
+		}
+
+		// runs within strict frames, which must not allocate
+		draw_cache_hostname(buf);
+
+		if (dgn_catch())
+		{
+			dgn_reset();
 		}
+
+		damage(buf, WIDGET_INFO_LINE);
 	}
+
+	return changed;
 }
 
-static void matrix_repeat(struct term_buf* term_buf)
+void animate_init(struct term_buf* buf) // throws
 {
-	u8* tmp = term_buf->tmp_buf;
+	buf->animation = NULL;
+	buf->animation_state = NULL;
 
-	if ((term_buf->width != term_buf->init_width) || (term_buf->height != term_buf->init_height))
+	if (!config.animate)
 	{
 		return;
 	}
 
-	struct tb_cell* buf = tb_cell_buffer();
+	const struct animation* animation = animation_find(config.animation);
 
-	for (u16 src = 0; src < term_buf->width * term_buf->height; ++src)
+	if (animation == NULL)
 	{
-		if (tmp[src])
-		{
-			buf[src].ch = tmp[src] & 127;
-			buf[src].fg = (tmp[src] & 128) ? 7 : 2;
-			buf[src].bg = 0;
-		}
-		else
-		{
-			buf[src].ch = ' ';
-			buf[src].fg = 7;
-			buf[src].bg = 0;
-		}
+		animation = animation_get(0);
+	}
+
+	u64 now = time_mono();
+	u64 seed = (config.seed != 0) ? config.seed : now;
+
+	buf->animation_state = animation->init(buf->width, buf->height, seed);
+
+	if (buf->animation_state == NULL)
+	{
+		return;
 	}
+
+	buf->animation = animation;
+
+	u16 fps = (config.fps > 0) ? config.fps : 1;
+	u16 rate = (animation->rate > 0) ? animation->rate : 1;
+
+	timer_init(&buf->frame, NSEC_PER_SEC / fps, now);
+	timer_init(&buf->step, NSEC_PER_SEC / rate, now);
 }
 
-void animate(struct term_buf* buf)
+void animate_free(struct term_buf* buf)
 {
-	buf->width = tb_width();
-	buf->height = tb_height();
+	if (buf->animation != NULL)
+	{
+		buf->animation->free(buf->animation_state);
+		buf->animation = NULL;
+		buf->animation_state = NULL;
+	}
+}
 
-	if (config.animate)
+// runs the simulation steps due by now, at the fixed rate of the
+// animation, and returns true when they must be presented;
+// late frames are skipped instead of being caught up
+bool animate_tick(struct term_buf* buf, u64 now)
+{
+	if ((buf->animation == NULL) || (timer_ticks(&buf->frame, now, 1) == 0))
 	{
-		switch(config.animation)
-		{
-			case 1:
-			{
-				static u8 frames = MATRIX_FRAMES;
-
-				if (--frames)
-				{
-					matrix_repeat(buf);
-				}
-				else
-				{
-					frames = MATRIX_FRAMES;
-					matrix(buf);
-				}
-
-				break;
-			}
-			default:
-			{
-				doom(buf);
-				break;
-			}
-		}
+		return false;
+	}
+
+	u32 max = (buf->frame.period / buf->step.period) + 1;
+	u32 steps = timer_ticks(&buf->step, now, max);
+
+	for (u32 i = 0; i < steps; ++i)
+	{
+		buf->animation->step(buf->animation_state);
+	}
+
+	if (steps > 0)
+	{
+		damage(buf, WIDGET_ANIMATION);
+	}
+
+	return steps > 0;
+}
+
+// milliseconds left before the next animation frame is due, or -1
+int animate_timeout(struct term_buf* buf, u64 now)
+{
+	if (buf->animation == NULL)
+	{
+		return -1;
+	}
+
+	return timer_timeout(&buf->frame, now);
+}
+
+// reprojects the animation state on the new size of the screen,
+// and stops the animation when it can't
+void animate_resize(struct term_buf* buf) // throws
+{
+	if (buf->animation == NULL)
+	{
+		return;
+	}
+
+	buf->animation->resize(buf->animation_state, buf->width, buf->height);
+
+	if (dgn_catch())
+	{
+		animate_free(buf);
+	}
+}
+
+void animate(struct term_buf* buf)
+{
+	if (buf->animation != NULL)
+	{
+		buf->animation->render(
+			buf->animation_state,
+			tb_cell_buffer(),
+			buf->full_damage || buf->animation_stale);
+
+		buf->animation_stale = false;
 	}
 }
 
-bool cascade(struct term_buf* term_buf, u8* fails)
+// moves the characters one cell down, returns false once they all landed
+bool cascade(struct term_buf* term_buf)
 {
-	u16 width = term_buf->width;
-	u16 height = term_buf->height;
+	// the terminal may have been resized since the last full draw
+	i32 width = tb_width();
+	i32 height = tb_height();
 
 	struct tb_cell* buf = tb_cell_buffer();
 	bool changes = false;
 	char c_under;
 	char c;
 
-	for (int i = height - 2; i >= 0; --i)
+	for (i32 i = height - 2; i >= 0; --i)
 	{
-		for (int k = 0; k < width; ++k)
+		for (i32 k = 0; k < width; ++k)
 		{
 			c = buf[i * width + k].ch;
 
@@ -830,7 +1040,7 @@ bool cascade(struct term_buf* term_buf, u8* fails)
 				changes = true;
 			}
 
-			if ((rand() % 10) > 7)
+			if ((prng_next(&term_buf->cascade_prng) % 10) > 7)
 			{
 				continue;
 			}
@@ -840,43 +1050,5 @@ bool cascade(struct term_buf* term_buf, u8* fails)
 		}
 	}
 
-	// stop force-updating 
-	if (!changes)
-	{
-		sleep(7);
-		*fails = 0;
-
-		return false;
-	}
-
-	// force-update
-	return true;
-}
-
-bool checkUpdate() {
-	return false;
-
-	static u8 frames = 0;
-
-	if (!frames)
-	{
-		switch (config.animation)
-		{
-			case 1:
-			{
-				frames = MATRIX_FRAMES;
-				break;
-			}
-			default:
-			{
-				frames = DOOM_FRAMES;
-				break;
-			}
-		}
-
-		return true;
-	}
-
-	--frames;
-	return false;
+	return changes;
 }
@@ -4,7 +4,58 @@
 #include "termbox.h"
 #include "ctypes.h"
 
+#include "animation.h"
 #include "inputs.h"
+#include "prng.h"
+#include "status.h"
+#include "timer.h"
+
+// the input widgets must stay in the same order as enum INPUTS
+enum widgets
+{
+	WIDGET_ANIMATION,
+	WIDGET_BOX,
+	WIDGET_LABELS,
+	WIDGET_INFO_LINE,
+	WIDGET_INFO_BAR,
+	WIDGET_CLOCK,
+	WIDGET_LOCK_STATE,
+	WIDGET_DESKTOP,
+	WIDGET_LOGIN,
+	WIDGET_PASSWORD,
+	WIDGET_COUNT,
+};
+
+struct rect
+{
+	u16 x;
+	u16 y;
+	u16 w;
+	u16 h;
+};
+
+struct widget
+{
+	struct rect rect;
+	bool dirty;
+};
+
+enum cache_entries
+{
+	CACHE_LOGIN,
+	CACHE_PASSWORD,
+	CACHE_NUMLOCK,
+	CACHE_CAPSLOCK,
+	CACHE_HOSTNAME,
+	CACHE_INFO_BAR,
+	CACHE_COUNT,
+};
+
+struct cell_str
+{
+	struct tb_cell* cells;
+	u16 len;
+};
 
 struct box
 {
@@ -22,29 +73,42 @@ struct term_buf
 {
 	u16 width;
 	u16 height;
-	u16 init_width;
-	u16 init_height;
 
 	struct box box_chars;
 	char* info_line;
+	char* hostname;
 	u16 labels_max_len;
 	u16 box_x;
 	u16 box_y;
 	u16 box_width;
 	u16 box_height;
 
-	u8* tmp_buf;
+	const struct animation* animation;
+	void* animation_state;
+	struct prng cascade_prng;
+	struct timer frame;
+	struct timer step;
+	bool animation_stale;
+
+	struct tb_cell* cache;
+	struct cell_str cached[CACHE_COUNT];
+
+	struct widget widgets[WIDGET_COUNT];
+	bool full_damage;
+	char* info_line_drawn;
+
+	struct status_poller status;
 };
 
-void draw_init(struct term_buf* buf);
+void draw_init(struct term_buf* buf, const struct status* seed);
+void draw_cache(struct term_buf* buf);
 void draw_free(struct term_buf* buf);
 void draw_box(struct term_buf* buf);
 
-struct tb_cell* strn_cell(char* s, u16 len, u8 fg, u8 bg);
-struct tb_cell* str_cell(char* s, u8 fg, u8 bg);
-
 void draw_labels(struct term_buf* buf);
+void draw_info_line(struct term_buf* buf);
 void draw_info_bar(struct term_buf* buf);
+void draw_clock(struct term_buf* buf);
 void draw_lock_state(struct term_buf* buf);
 void draw_desktop(struct desktop* target);
 void draw_input(struct text* input);
@@ -56,9 +120,21 @@ void position_input(
 	struct text* login,
 	struct text* password);
 
+void damage(struct term_buf* buf, enum widgets widget);
+void damage_all(struct term_buf* buf);
+bool draw_damaged(
+	struct term_buf* buf,
+	struct desktop* desktop,
+	struct text* login,
+	struct text* password);
+u32 poll_status(struct term_buf* buf, u64 now);
+
 void animate_init(struct term_buf* buf);
+void animate_free(struct term_buf* buf);
+bool animate_tick(struct term_buf* buf, u64 now);
+int animate_timeout(struct term_buf* buf, u64 now);
+void animate_resize(struct term_buf* buf);
 void animate(struct term_buf* buf);
-bool cascade(struct term_buf* buf, u8* fails);
-bool checkUpdate();
+bool cascade(struct term_buf* buf);
 
 #endif
@@ -0,0 +1,234 @@
+#include "dragonfail.h"
+#include "ctypes.h"
+
+#include "exec.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// commands follow the quoting rules of the Exec key of desktop entries:
+// arguments are separated by spaces, double quotes keep them together
+// and a backslash escapes the next char; field codes like %f or %U
+// only exist in desktop entries, and there is nothing to expand them to
+
+#define EXEC_ARGS 8
+
+void exec_init(struct exec* exec)
+{
+	exec->argv = NULL;
+	exec->len = 0;
+	exec->size = 0;
+}
+
+// takes the argument over
+static void exec_push(struct exec* exec, char* arg) // throws
+{
+	if ((exec->len + 2) > exec->size)
+	{
+		u16 size = (exec->size == 0) ? EXEC_ARGS : (2 * exec->size);
+		char** argv = realloc(exec->argv, size * (sizeof (char*)));
+
+		if (argv == NULL)
+		{
+			free(arg);
+			dgn_throw(DGN_ALLOC);
+			return;
+		}
+
+		exec->argv = argv;
+		exec->size = size;
+	}
+
+	exec->argv[exec->len] = arg;
+	++exec->len;
+	exec->argv[exec->len] = NULL;
+}
+
+void exec_arg(struct exec* exec, const char* arg) // throws
+{
+	char* copy = strdup(arg);
+
+	if (copy == NULL)
+	{
+		dgn_throw(DGN_ALLOC);
+		return;
+	}
+
+	exec_push(exec, copy);
+}
+
+static bool exec_space(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n');
+}
+
+static void exec_split(struct exec* exec, const char* cmd, bool desktop) // throws
+{
+	const char* home = getenv("HOME");
+	size_t home_len = (home != NULL) ? strlen(home) : 0;
+	size_t cmd_len = strlen(cmd);
+	const char* pos = cmd;
+
+	while (true)
+	{
+		while (exec_space(*pos))
+		{
+			++pos;
+		}
+
+		if (*pos == '\0')
+		{
+			return;
+		}
+
+		char* arg = malloc(home_len + cmd_len + 1);
+		size_t len = 0;
+		// arguments made of field codes only are dropped, unlike ""
+		bool keep = false;
+		bool quoted = false;
+
+		if (arg == NULL)
+		{
+			dgn_throw(DGN_ALLOC);
+			return;
+		}
+
+		// for the xinitrc entry, which is not read from a desktop file
+		if ((pos[0] == '~')
+			&& (home != NULL)
+			&& ((pos[1] == '/') || (pos[1] == '\0') || exec_space(pos[1])))
+		{
+			memcpy(arg, home, home_len);
+			len = home_len;
+			keep = true;
+			++pos;
+		}
+
+		while ((*pos != '\0') && (quoted || !exec_space(*pos)))
+		{
+			if (*pos == '"')
+			{
+				quoted = !quoted;
+				keep = true;
+				++pos;
+			}
+			else if ((*pos == '\\')
+				&& (pos[1] != '\0')
+				&& (!quoted || (strchr("\"`$\\", pos[1]) != NULL)))
+			{
+				arg[len] = pos[1];
+				++len;
+				keep = true;
+				pos += 2;
+			}
+			else if (desktop && !quoted && (*pos == '%') && (pos[1] != '\0'))
+			{
+				if (pos[1] == '%')
+				{
+					arg[len] = '%';
+					++len;
+					keep = true;
+				}
+
+				pos += 2;
+			}
+			else
+			{
+				arg[len] = *pos;
+				++len;
+				keep = true;
+				++pos;
+			}
+		}
+
+		arg[len] = '\0';
+
+		if (!keep)
+		{
+			free(arg);
+			continue;
+		}
+
+		exec_push(exec, arg);
+
+		if (dgn_catch())
+		{
+			return;
+		}
+	}
+}
+
+// splits a command of the configuration
+void exec_cmd(struct exec* exec, const char* cmd) // throws
+{
+	exec_split(exec, cmd, false);
+}
+
+// splits the Exec value of a desktop entry, which is itself escaped
+// like every string of these files
+void exec_desktop(struct exec* exec, const char* cmd) // throws
+{
+	char* unescaped = malloc(strlen(cmd) + 1);
+	size_t len = 0;
+
+	if (unescaped == NULL)
+	{
+		dgn_throw(DGN_ALLOC);
+		return;
+	}
+
+	// the others are left for the quoting rules
+	const char* codes = "sntr\\";
+	const char* chars = " \n\t\r\\";
+
+	for (const char* pos = cmd; *pos != '\0'; ++pos)
+	{
+		const char* code = strchr(codes, pos[1]);
+
+		if ((*pos == '\\') && (pos[1] != '\0') && (code != NULL))
+		{
+			unescaped[len] = chars[code - codes];
+			++pos;
+		}
+		else
+		{
+			unescaped[len] = *pos;
+		}
+
+		++len;
+	}
+
+	unescaped[len] = '\0';
+	exec_split(exec, unescaped, true);
+	free(unescaped);
+}
+
+// only returns when the program could not be started, or when building
+// its arguments failed
+void exec_run(struct exec* exec) // throws
+{
+	if (dgn_catch())
+	{
+		return;
+	}
+
+	if (exec->len > 0)
+	{
+		execvp(exec->argv[0], exec->argv);
+	}
+
+	dgn_throw(DGN_EXEC);
+}
+
+void exec_free(struct exec* exec)
+{
+	for (u16 i = 0; i < exec->len; ++i)
+	{
+		free(exec->argv[i]);
+	}
+
+	free(exec->argv);
+	exec_init(exec);
+}
@@ -0,0 +1,25 @@
+#ifndef H_LY_EXEC
+#define H_LY_EXEC
+
+#include "ctypes.h"
+
+// exit status of the children which could not start their program,
+// the one shells use for a command not found
+#define EXEC_FAILURE 127
+
+// arguments of a program started without a shell, kept NULL-terminated
+struct exec
+{
+	char** argv;
+	u16 len;
+	u16 size;
+};
+
+void exec_init(struct exec* exec);
+void exec_arg(struct exec* exec, const char* arg);
+void exec_cmd(struct exec* exec, const char* cmd);
+void exec_desktop(struct exec* exec, const char* cmd);
+void exec_run(struct exec* exec);
+void exec_free(struct exec* exec);
+
+#endif
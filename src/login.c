@@ -3,11 +3,16 @@
 
 #include "inputs.h"
 #include "draw.h"
+#include "exec.h"
 #include "utils.h"
 #include "config.h"
 #include "login.h"
+#include "loop.h"
+#include "timer.h"
+#include "xauth.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <grp.h>
 #include <pwd.h>
 #include <security/pam_appl.h>
@@ -15,42 +20,121 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #include <utmp.h>
 #include <xcb/xcb.h>
 
-int get_free_display()
+// a colon, up to 13 digits and the terminator
+#define XORG_DISPLAY_LEN 16
+
+// time a cancelled helper gets to clean up, checked every step
+#define AUTH_CANCEL_GRACE_MS 500
+#define AUTH_CANCEL_STEP_MS 10
+
+void reset_terminal()
 {
-	char xlock[1024];
-	u8 i;
+	pid_t pid = fork();
 
-	for (i = 0; i < 200; ++i)
+	if (pid == 0)
 	{
-		snprintf(xlock, 1024, "/tmp/.X%d-lock", i);
+		struct exec exec;
 
-		if (access(xlock, F_OK) == -1)
-		{
-			break;
-		}
+		loop_child();
+		exec_init(&exec);
+		exec_cmd(&exec, config.term_reset_cmd);
+		exec_run(&exec);
+		_exit(EXEC_FAILURE);
 	}
 
-	return i;
+	int status;
+	waitpid(pid, &status, 0);
 }
 
-void reset_terminal(struct passwd* pwd)
+// messages between the greeter and the authentication helper
+enum auth_messages
 {
-	pid_t pid = fork();
+	// from the helper
+	AUTH_MSG_PROMPT,
+	AUTH_MSG_INFO,
+	AUTH_MSG_SESSION,
+	AUTH_MSG_PAM,
+	AUTH_MSG_DGN,
+	AUTH_MSG_DONE,
+	// from the greeter
+	AUTH_MSG_ANSWER,
+	AUTH_MSG_START,
+	// the helper exited without a result
+	AUTH_MSG_LOST,
+};
+
+struct auth_message
+{
+	u8 type;
+	i32 code;
+	char text[AUTH_TEXT_LEN];
+};
+
+// the login and password typed in the greeter answer the first
+// prompts of their kind, the user is asked for the next ones
+struct conv_data
+{
+	int fd;
+	char* login;
+	char* password;
+	bool login_used;
+	bool password_used;
+};
 
-	if (pid == 0)
+static void auth_send(int fd, u8 type, i32 code, const char* text)
+{
+	struct auth_message message = {0};
+	message.type = type;
+	message.code = code;
+
+	if (text != NULL)
 	{
-		execl(pwd->pw_shell, pwd->pw_shell, "-c", config.term_reset_cmd, NULL);
-		exit(EXIT_SUCCESS);
+		strncpy(message.text, text, AUTH_TEXT_LEN - 1);
 	}
 
-	int status;
-	waitpid(pid, &status, 0);
+	send(fd, &message, sizeof (message), MSG_NOSIGNAL);
+}
+
+static char* conv_ask(struct conv_data* data, const char* prompt)
+{
+	struct auth_message message;
+	auth_send(data->fd, AUTH_MSG_PROMPT, 0, prompt);
+
+	if ((recv(data->fd, &message, sizeof (message), 0) != sizeof (message))
+		|| (message.type != AUTH_MSG_ANSWER))
+	{
+		return NULL;
+	}
+
+	message.text[AUTH_TEXT_LEN - 1] = '\0';
+	char* answer = strdup(message.text);
+	memset(message.text, 0, AUTH_TEXT_LEN);
+
+	return answer;
+}
+
+static char* conv_answer(
+	struct conv_data* data,
+	const char* prompt,
+	char* typed,
+	bool* used)
+{
+	if (*used)
+	{
+		return conv_ask(data, prompt);
+	}
+
+	*used = true;
+
+	return strdup(typed);
 }
 
 int login_conv(
@@ -66,8 +150,7 @@ int login_conv(
 		return PAM_BUF_ERR;
 	}
 
-	char* username;
-	char* password;
+	struct conv_data* data = appdata_ptr;
 	int ok = PAM_SUCCESS;
 	int i;
 
@@ -77,23 +160,39 @@ int login_conv(
 		{
 			case PAM_PROMPT_ECHO_ON:
 			{
-				username = ((char**) appdata_ptr)[0];
-				(*resp)[i].resp = strdup(username);
+				(*resp)[i].resp = conv_answer(
+					data,
+					msg[i]->msg,
+					data->login,
+					&data->login_used);
+
 				break;
 			}
 			case PAM_PROMPT_ECHO_OFF:
 			{
-				password = ((char**) appdata_ptr)[1];
-				(*resp)[i].resp = strdup(password);
+				(*resp)[i].resp = conv_answer(
+					data,
+					msg[i]->msg,
+					data->password,
+					&data->password_used);
+
 				break;
 			}
 			case PAM_ERROR_MSG:
+			case PAM_TEXT_INFO:
 			{
-				ok = PAM_CONV_ERR;
+				auth_send(data->fd, AUTH_MSG_INFO, 0, msg[i]->msg);
 				break;
 			}
 		}
 
+		if (((msg[i]->msg_style == PAM_PROMPT_ECHO_ON)
+			|| (msg[i]->msg_style == PAM_PROMPT_ECHO_OFF))
+			&& ((*resp)[i].resp == NULL))
+		{
+			ok = PAM_CONV_ERR;
+		}
+
 		if (ok != PAM_SUCCESS)
 		{
 			break;
@@ -303,13 +402,19 @@ void remove_utmp_entry(struct utmp *entry) {
 	endutent();
 }
 
-void xauth(const char* display_name, const char* shell, const char* dir)
+void xauth(const char* display_name, const char* shell, const char* dir) // throws
 {
 	char xauthority[256];
 	snprintf(xauthority, 256, "%s/%s", dir, ".lyxauth");
 	setenv("XAUTHORITY", xauthority, 1);
 	setenv("DISPLAY", display_name, 1);
 
+	if (config.xauth_cmd[0] == '\0')
+	{
+		xauth_add(xauthority, display_name + 1);
+		return;
+	}
+
 	FILE* fp = fopen(xauthority, "ab+");
 
 	if (fp != NULL)
@@ -330,19 +435,93 @@ void xauth(const char* display_name, const char* shell, const char* dir)
 			display_name,
 			config.mcookie_cmd);
 		execl(shell, shell, "-c", cmd, NULL);
-		exit(EXIT_SUCCESS);
+		_exit(EXIT_SUCCESS);
 	}
 
 	int status;
 	waitpid(pid, &status, 0);
 }
 
+// the X server sends SIGUSR1 to its parent when it starts accepting
+// connections if it inherited the signal ignored; the server is
+// stopped if it does not within x_timeout seconds
+static void xorg_wait(pid_t pid, sigset_t* set) // throws
+{
+	u64 deadline = time_mono() + (config.x_timeout * NSEC_PER_SEC);
+	siginfo_t info;
+	int sig;
+
+	while (true)
+	{
+		if (config.x_timeout == 0)
+		{
+			sig = sigwaitinfo(set, &info);
+		}
+		else
+		{
+			u64 now = time_mono();
+
+			if (now >= deadline)
+			{
+				kill(pid, SIGTERM);
+				waitpid(pid, NULL, 0);
+				dgn_throw(DGN_XORG);
+				return;
+			}
+
+			struct timespec left =
+			{
+				.tv_sec = (deadline - now) / NSEC_PER_SEC,
+				.tv_nsec = (deadline - now) % NSEC_PER_SEC,
+			};
+
+			sig = sigtimedwait(set, &info, &left);
+		}
+
+		if (sig == SIGUSR1)
+		{
+			return;
+		}
+
+		// the server exited before being ready
+		if ((sig == SIGCHLD) && (waitpid(pid, NULL, WNOHANG) == pid))
+		{
+			dgn_throw(DGN_XORG);
+			return;
+		}
+	}
+}
+
+// the display number is written before the readiness signal is sent
+static void xorg_display(int fd, char* display_name) // throws
+{
+	char number[XORG_DISPLAY_LEN - 1];
+	ssize_t len = read(fd, number, XORG_DISPLAY_LEN - 2);
+
+	if (len <= 0)
+	{
+		dgn_throw(DGN_XORG);
+		return;
+	}
+
+	number[len] = '\0';
+	number[strcspn(number, "\n")] = '\0';
+
+	if ((number[0] == '\0') || (strspn(number, "0123456789") != strlen(number)))
+	{
+		dgn_throw(DGN_XORG);
+		return;
+	}
+
+	snprintf(display_name, XORG_DISPLAY_LEN, ":%s", number);
+}
+
 void xorg(
 	struct passwd* pwd,
 	const char* vt,
-	const char* desktop_cmd)
+	const char* desktop_cmd) // throws
 {
-	// generate xauthority file
+	// the xauthority file is generated once the display is known
 	const char* xauth_dir = getenv("XDG_CONFIG_HOME");
 
 	if ((xauth_dir == NULL) || (*xauth_dir == '\0'))
@@ -350,41 +529,83 @@ void xorg(
 		xauth_dir = pwd->pw_dir;
 	}
 
-	char display_name[4];
+	// start xorg, the signals stay blocked to be waited for
+	sigset_t set;
+	sigset_t old;
+	int display_fd[2];
 
-	snprintf(display_name, 3, ":%d", get_free_display());
-	xauth(display_name, pwd->pw_shell, xauth_dir);
+	if (pipe(display_fd) != 0)
+	{
+		dgn_throw(DGN_XORG);
+		return;
+	}
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGUSR1);
+	sigaddset(&set, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &set, &old);
 
-	// start xorg
 	pid_t pid = fork();
 
 	if (pid == 0)
 	{
-		char x_cmd[1024];
-		snprintf(
-			x_cmd,
-			1024,
-			"%s %s %s",
-			config.x_cmd,
-			display_name,
-			vt);
-		execl(pwd->pw_shell, pwd->pw_shell, "-c", x_cmd, NULL);
-		exit(EXIT_SUCCESS);
+		// makes the server signal its parent once it is ready
+		signal(SIGUSR1, SIG_IGN);
+		sigprocmask(SIG_SETMASK, &old, NULL);
+		close(display_fd[0]);
+
+		// the server picks the first free display and writes it back
+		struct exec exec;
+		char fd[12];
+
+		snprintf(fd, 12, "%d", display_fd[1]);
+		exec_init(&exec);
+		exec_cmd(&exec, config.x_cmd);
+		exec_arg(&exec, "-displayfd");
+		exec_arg(&exec, fd);
+		exec_arg(&exec, vt);
+		exec_run(&exec);
+		_exit(EXEC_FAILURE);
 	}
 
-	int ok;
-	xcb_connection_t* xcb;
+	close(display_fd[1]);
+	xorg_wait(pid, &set);
+
+	if (dgn_catch())
+	{
+		close(display_fd[0]);
+		return;
+	}
+
+	char display_name[XORG_DISPLAY_LEN];
+	xorg_display(display_fd[0], display_name);
+	close(display_fd[0]);
+
+	if (dgn_catch())
+	{
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	xauth(display_name, pwd->pw_shell, xauth_dir);
 
-	do
+	if (dgn_catch())
 	{
-		xcb = xcb_connect(NULL, NULL);
-		ok = xcb_connection_has_error(xcb);
-		kill(pid, 0);
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		return;
 	}
-	while((ok != 0) && (errno != ESRCH));
 
-	if (ok != 0)
+	// keeps the server from resetting while the session runs
+	xcb_connection_t* xcb = xcb_connect(NULL, NULL);
+
+	if (xcb_connection_has_error(xcb) != 0)
 	{
+		xcb_disconnect(xcb);
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		dgn_throw(DGN_XORG);
 		return;
 	}
 
@@ -392,20 +613,23 @@ void xorg(
 
 	if (xorg_pid == 0)
 	{
-		char de_cmd[1024];
-		snprintf(
-			de_cmd,
-			1024,
-			"%s %s",
-			config.x_cmd_setup,
-			desktop_cmd);
-		execl(pwd->pw_shell, pwd->pw_shell, "-c", de_cmd, NULL);
-		exit(EXIT_SUCCESS);
+		struct exec exec;
+
+		sigprocmask(SIG_SETMASK, &old, NULL);
+		exec_init(&exec);
+		exec_cmd(&exec, config.x_cmd_setup);
+		exec_desktop(&exec, desktop_cmd);
+		exec_run(&exec);
+		_exit(EXEC_FAILURE);
 	}
 
 	int status;
 	waitpid(xorg_pid, &status, 0);
 	xcb_disconnect(xcb);
+
+	// the setup script returns the same status when the desktop is missing
+	bool failed = WIFEXITED(status) && (WEXITSTATUS(status) == EXEC_FAILURE);
+
 	kill(pid, 0);
 
 	if (errno != ESRCH)
@@ -413,19 +637,25 @@ void xorg(
 		kill(pid, SIGTERM);
 		waitpid(pid, &status, 0);
 	}
+
+	if (failed)
+	{
+		dgn_throw(DGN_EXEC);
+	}
 }
 
-void wayland(
-	struct passwd* pwd,
-	const char* desktop_cmd)
+void wayland(const char* desktop_cmd) // throws
 {
+	struct exec exec;
 
-	char cmd[1024];
-	snprintf(cmd, 1024, "%s %s", config.wayland_cmd, desktop_cmd);
-	execl(pwd->pw_shell, pwd->pw_shell, "-c", cmd, NULL);
+	exec_init(&exec);
+	exec_cmd(&exec, config.wayland_cmd);
+	exec_desktop(&exec, desktop_cmd);
+	exec_run(&exec);
+	exec_free(&exec);
 }
 
-void shell(struct passwd* pwd)
+void shell(struct passwd* pwd) // throws
 {
 	const char* pos = strrchr(pwd->pw_shell, '/');
 	char args[1024];
@@ -442,70 +672,88 @@ void shell(struct passwd* pwd)
 
 	strncpy(args + 1, pos, 1023);
 	execl(pwd->pw_shell, args, NULL);
+	dgn_throw(DGN_EXEC);
 }
 
+
 // pam_do performs the pam action specified in pam_action
-// on pam_action fail, call diagnose and end pam session
+// on pam_action fail, report the error and end pam session
 int pam_do(
 	int (pam_action)(struct pam_handle *, int),
 	struct pam_handle *handle,
 	int flags,
-	struct term_buf *buf)
+	int fd)
 {
 	int status = pam_action(handle, flags);
 
 	if (status != PAM_SUCCESS) {
-		pam_diagnose(status, buf);
+		auth_send(fd, AUTH_MSG_PAM, status, NULL);
 		pam_end(handle, status);
 	}
 
 	return status;
 }
 
-void auth(
+// the greeter reads this before the helper reports the session end
+static void session_fail(int fd)
+{
+	auth_send(fd, AUTH_MSG_DGN, dgn_output_code(), NULL);
+	_exit(EXIT_FAILURE);
+}
+
+// runs in its own process, so that a slow pam stack never blocks
+// the greeter; the answers and results go through the socket
+static void auth_helper(
+	int fd,
 	struct desktop* desktop,
 	struct text* login,
-	struct text* password,
-	struct term_buf* buf)
+	struct text* password)
 {
 	int ok;
 
 	// open pam session
-	const char* creds[2] = {login->text, password->text};
-	struct pam_conv conv = {login_conv, creds};
+	struct conv_data data = {fd, login->text, password->text, false, false};
+	struct pam_conv conv = {login_conv, &data};
 	struct pam_handle* handle;
 
 	ok = pam_start(config.service_name, NULL, &conv, &handle);
 
 	if (ok != PAM_SUCCESS)
 	{
-		pam_diagnose(ok, buf);
+		auth_send(fd, AUTH_MSG_PAM, ok, NULL);
 		pam_end(handle, ok);
 		return;
 	}
 
-	ok = pam_do(pam_authenticate, handle, 0, buf);
+	ok = pam_do(pam_authenticate, handle, 0, fd);
 
 	if (ok != PAM_SUCCESS)
 	{
 		return;
 	}
 
-	ok = pam_do(pam_acct_mgmt, handle, 0, buf);
+	// a cancelled login is killed with SIGTERM only while authenticating,
+	// from here on the helper must close what it opens itself
+	sigset_t term;
+	sigemptyset(&term);
+	sigaddset(&term, SIGTERM);
+	sigprocmask(SIG_BLOCK, &term, NULL);
+
+	ok = pam_do(pam_acct_mgmt, handle, 0, fd);
 
 	if (ok != PAM_SUCCESS)
 	{
 		return;
 	}
 
-	ok = pam_do(pam_setcred, handle, PAM_ESTABLISH_CRED, buf);
+	ok = pam_do(pam_setcred, handle, PAM_ESTABLISH_CRED, fd);
 
 	if (ok != PAM_SUCCESS)
 	{
 		return;
 	}
 
-	ok = pam_do(pam_open_session, handle, 0, buf);
+	ok = pam_do(pam_open_session, handle, 0, fd);
 
 	if (ok != PAM_SUCCESS)
 	{
@@ -521,7 +769,7 @@ void auth(
 
 	if (pwd == NULL)
 	{
-		dgn_throw(DGN_PWNAM);
+		auth_send(fd, AUTH_MSG_DGN, DGN_PWNAM, NULL);
 		pam_end(handle, ok);
 		return;
 	}
@@ -541,23 +789,36 @@ void auth(
 		endusershell();
 	}
 
-	// restore regular terminal mode
-	tb_clear();
-	tb_present();
-	tb_shutdown();
+	// the greeter gives the terminal away before the session starts
+	struct auth_message message;
+	auth_send(fd, AUTH_MSG_SESSION, 0, NULL);
+
+	if ((recv(fd, &message, sizeof (message), 0) != sizeof (message))
+		|| (message.type != AUTH_MSG_START))
+	{
+		pam_close_session(handle, 0);
+		pam_setcred(handle, PAM_DELETE_CRED);
+		pam_end(handle, ok);
+		return;
+	}
 
 	// start desktop environment
 	pid_t pid = fork();
 
 	if (pid == 0)
 	{
+		loop_child();
+
+		// kept to report failures, but not passed on to the session
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+
 		// set user info 
 		ok = initgroups(pwd->pw_name, pwd->pw_gid);
 
 		if (ok != 0)
 		{
 			dgn_throw(DGN_USER_INIT);
-			exit(EXIT_FAILURE);
+			session_fail(fd);
 		}
 
 		ok = setgid(pwd->pw_gid);
@@ -565,7 +826,7 @@ void auth(
 		if (ok != 0)
 		{
 			dgn_throw(DGN_USER_GID);
-			exit(EXIT_FAILURE);
+			session_fail(fd);
 		}
 
 		ok = setuid(pwd->pw_uid);
@@ -573,7 +834,7 @@ void auth(
 		if (ok != 0)
 		{
 			dgn_throw(DGN_USER_UID);
-			exit(EXIT_FAILURE);
+			session_fail(fd);
 		}
 
 		// get a display
@@ -588,7 +849,7 @@ void auth(
 
 		if (dgn_catch())
 		{
-			exit(EXIT_FAILURE);
+			session_fail(fd);
 		}
 
 		// add pam variables
@@ -608,15 +869,15 @@ void auth(
 		if (ok != 0)
 		{
 			dgn_throw(DGN_CHDIR);
-			exit(EXIT_FAILURE);
+			session_fail(fd);
 		}
 
-		reset_terminal(pwd);
+		reset_terminal();
 		switch (desktop->display_server[desktop->cur])
 		{
 			case DS_WAYLAND:
 			{
-				wayland(pwd, desktop->cmd[desktop->cur]);
+				wayland(desktop->cmd[desktop->cur]);
 				break;
 			}
 			case DS_SHELL:
@@ -632,7 +893,12 @@ void auth(
 			}
 		}
 
-		exit(EXIT_SUCCESS);
+		if (dgn_catch())
+		{
+			session_fail(fd);
+		}
+
+		_exit(EXIT_SUCCESS);
 	}
 
 	/* TODO: Fork session to a new TTY, reload Ly */
@@ -646,27 +912,17 @@ void auth(
 	waitpid(pid, &status, 0);
 	remove_utmp_entry(&entry);
 
-	reset_terminal(pwd);
-
-	// reinit termbox
-	tb_set_clear_attributes(config.fg, config.bg_default);
-	tb_init();
-	tb_select_output_mode(TB_OUTPUT_256);
-
-	// reload the desktop environment list on logout
-	input_desktop_free(desktop);
-	input_desktop(desktop);
-	desktop_load(desktop);
+	reset_terminal();
 
 	// close pam session
-	ok = pam_do(pam_close_session, handle, 0, buf);
+	ok = pam_do(pam_close_session, handle, 0, fd);
 	
 	if (ok != PAM_SUCCESS)
 	{
 		return;
 	}
 
-	ok = pam_do(pam_setcred, handle, PAM_DELETE_CRED, buf);
+	ok = pam_do(pam_setcred, handle, PAM_DELETE_CRED, fd);
 	
 	if (ok != PAM_SUCCESS)
 	{
@@ -677,7 +933,240 @@ void auth(
 	
 	if (ok != PAM_SUCCESS)
 	{
-		pam_diagnose(ok, buf);
+		auth_send(fd, AUTH_MSG_PAM, ok, NULL);
+		return;
+	}
+
+	auth_send(fd, AUTH_MSG_DONE, 0, NULL);
+}
+
+// forks the helper; its messages are then read with auth_read
+// whenever the loop finds the socket readable
+void auth_start(
+	struct auth* auth,
+	struct loop* loop,
+	struct desktop* desktop,
+	struct text* login,
+	struct text* password) // throws
+{
+	int fds[2];
+
+	auth->pid = -1;
+	auth->fd = -1;
+	auth->loop = loop;
+	auth->message[0] = '\0';
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0)
+	{
+		dgn_throw(DGN_PAM);
+		return;
+	}
+
+	// the children leave with _exit, and must not inherit buffered
+	// output of the greeter, like the session record
+	fflush(NULL);
+	auth->pid = fork();
+
+	if (auth->pid == 0)
+	{
+		loop_child();
+		close(fds[0]);
+		auth_helper(fds[1], desktop, login, password);
+		close(fds[1]);
+		_exit(EXIT_SUCCESS);
+	}
+
+	close(fds[1]);
+
+	if (auth->pid < 0)
+	{
+		close(fds[0]);
+		dgn_throw(DGN_PAM);
+		return;
+	}
+
+	auth->fd = fds[0];
+	loop_helper(loop, auth->fd);
+}
+
+// the exit status does not matter, the results come through the
+// socket; the pid is cleared when the greeter already reaped it
+static void auth_end(struct auth* auth)
+{
+	// before the descriptor can be reused
+	loop_helper(auth->loop, -1);
+	close(auth->fd);
+
+	if (auth->pid > 0)
+	{
+		waitpid(auth->pid, NULL, 0);
+	}
+
+	auth->fd = -1;
+	auth->pid = -1;
+}
+
+static void auth_result(struct auth_message* message, struct term_buf* buf)
+{
+	switch (message->type)
+	{
+		case AUTH_MSG_PAM:
+		{
+			pam_diagnose(message->code, buf);
+			break;
+		}
+		case AUTH_MSG_DGN:
+		{
+			dgn_throw(message->code);
+			break;
+		}
+		case AUTH_MSG_DONE:
+		{
+			break;
+		}
+		case AUTH_MSG_LOST:
+		default:
+		{
+			pam_diagnose(PAM_ABORT, buf);
+			break;
+		}
+	}
+}
+
+// hands the terminal over to the session, and waits for it to end
+static void auth_session(
+	struct auth* auth,
+	struct desktop* desktop,
+	struct text* password,
+	struct term_buf* buf)
+{
+	struct auth_message message;
+
+	input_text_clear(password);
+
+	// restore regular terminal mode
+	tb_clear();
+	tb_present();
+	tb_shutdown();
+
+	auth_send(auth->fd, AUTH_MSG_START, 0, NULL);
+
+	if (recv(auth->fd, &message, sizeof (message), 0) != sizeof (message))
+	{
+		message.type = AUTH_MSG_LOST;
+	}
+
+	auth_end(auth);
+
+	// reinit termbox
+	tb_set_clear_attributes(config.fg, config.bg_default);
+	tb_init();
+	tb_select_output_mode(TB_OUTPUT_256);
+
+	// reload the desktop environment list on logout
+	input_desktop_free(desktop);
+	input_desktop(desktop);
+	desktop_load(desktop);
+
+	if (dgn_catch())
+	{
+		dgn_reset();
+	}
+
+	auth_result(&message, buf);
+}
+
+// handles a message of the helper
+enum auth_status auth_read(
+	struct auth* auth,
+	struct desktop* desktop,
+	struct text* password,
+	struct term_buf* buf) // throws
+{
+	struct auth_message message;
+
+	if (recv(auth->fd, &message, sizeof (message), 0) != sizeof (message))
+	{
+		message.type = AUTH_MSG_LOST;
+	}
+
+	message.text[AUTH_TEXT_LEN - 1] = '\0';
+
+	switch (message.type)
+	{
+		case AUTH_MSG_PROMPT:
+		{
+			memcpy(auth->message, message.text, AUTH_TEXT_LEN);
+			buf->info_line = auth->message;
+			return AUTH_PROMPT;
+		}
+		case AUTH_MSG_INFO:
+		{
+			memcpy(auth->message, message.text, AUTH_TEXT_LEN);
+			buf->info_line = auth->message;
+			return AUTH_PENDING;
+		}
+		case AUTH_MSG_SESSION:
+		{
+			auth_session(auth, desktop, password, buf);
+			return AUTH_FINISHED;
+		}
+		default:
+		{
+			auth_end(auth);
+			auth_result(&message, buf);
+			return AUTH_FINISHED;
+		}
 	}
 }
 
+// replies to the last prompt, the answer is cleared afterwards
+void auth_answer(struct auth* auth, struct text* answer)
+{
+	auth_send(auth->fd, AUTH_MSG_ANSWER, 0, answer->text);
+	input_text_clear(answer);
+	auth->message[0] = '\0';
+}
+
+// the helper may be anywhere in the pam stack, even waiting to start
+// an opened session; shutting the socket down fails its next read or
+// prompt, after which it closes the session and deletes the credentials
+// itself, so only a helper still authenticating is killed, after a grace
+void auth_cancel(struct auth* auth)
+{
+	struct auth_message message;
+	bool opened = false;
+
+	while (recv(auth->fd, &message, sizeof (message), MSG_DONTWAIT)
+		== sizeof (message))
+	{
+		opened |= message.type == AUTH_MSG_SESSION;
+	}
+
+	shutdown(auth->fd, SHUT_RDWR);
+
+	struct timespec step = {0, AUTH_CANCEL_STEP_MS * NSEC_PER_MSEC};
+	u16 steps = AUTH_CANCEL_GRACE_MS / AUTH_CANCEL_STEP_MS;
+
+	while ((auth->pid > 0) && (steps > 0))
+	{
+		if (waitpid(auth->pid, NULL, WNOHANG) == auth->pid)
+		{
+			auth->pid = -1;
+			break;
+		}
+
+		nanosleep(&step, NULL);
+		--steps;
+	}
+
+	// blocked by the helper once authenticated, it is then left
+	// to the reaper instead of being waited for here
+	if ((auth->pid > 0) && !opened)
+	{
+		kill(auth->pid, SIGTERM);
+	}
+
+	auth->pid = -1;
+	auth_end(auth);
+}
@@ -3,11 +3,44 @@
 
 #include "draw.h"
 #include "inputs.h"
+#include "loop.h"
 
-void auth(
+#include <sys/types.h>
+
+#define AUTH_TEXT_LEN 256
+
+enum auth_status
+{
+	AUTH_PENDING,
+	// the last message is a question, to answer with auth_answer
+	AUTH_PROMPT,
+	// the helper is gone, after a failure or the end of the session
+	AUTH_FINISHED,
+};
+
+// a login being handled by the authentication helper
+struct auth
+{
+	pid_t pid;
+	// watched by the loop for as long as it is open
+	int fd;
+	struct loop* loop;
+	// last prompt or message of the pam stack
+	char message[AUTH_TEXT_LEN];
+};
+
+void auth_start(
+	struct auth* auth,
+	struct loop* loop,
 	struct desktop* desktop,
 	struct text* login,
+	struct text* password);
+enum auth_status auth_read(
+	struct auth* auth,
+	struct desktop* desktop,
 	struct text* password,
 	struct term_buf* buf);
+void auth_answer(struct auth* auth, struct text* answer);
+void auth_cancel(struct auth* auth);
 
 #endif
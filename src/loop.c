@@ -0,0 +1,408 @@
+#include "dragonfail.h"
+#include "ctypes.h"
+
+#include "loop.h"
+#include "timer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+	#include <sys/epoll.h>
+	#include <sys/inotify.h>
+	#include <sys/signalfd.h>
+	#include <sys/timerfd.h>
+#else
+	#include <poll.h>
+#endif
+
+// single-threaded reactor: ly sleeps in loop_wait until a key is typed,
+// a signal arrives, a deadline expires, a sessions folder changes or
+// the authentication helper has something to say.
+//
+// The signals handled by the loop are blocked the rest of the time;
+// SIGWINCH is also blocked outside of loop_wait, so that the handler
+// termbox installs for it can only interrupt the wait itself and the
+// resize is never missed between two waits.
+
+static const int loop_signals[] =
+{
+	SIGTERM,
+	SIGHUP,
+	SIGCHLD,
+	// dumps the profile summary
+	SIGUSR1,
+};
+
+#define LOOP_SIGNALS_LEN ((sizeof (loop_signals)) / (sizeof (int)))
+
+// mask of the process before the loop, restored in children
+static sigset_t original_mask;
+
+#if !defined(__linux__)
+// without signalfd the signals are flagged by a regular handler
+static volatile sig_atomic_t pending[LOOP_SIGNALS_LEN];
+
+static void loop_flag(int signal)
+{
+	for (u8 i = 0; i < LOOP_SIGNALS_LEN; ++i)
+	{
+		if (loop_signals[i] == signal)
+		{
+			pending[i] = 1;
+		}
+	}
+}
+#endif
+
+void loop_init(
+	struct loop* loop,
+	const struct loop_handlers* handlers,
+	void* data) // throws
+{
+	loop->handlers = handlers;
+	loop->data = data;
+	loop->epoll_fd = -1;
+	loop->deadline = 0;
+
+	for (u8 i = 0; i < LOOP_COUNT; ++i)
+	{
+		loop->fds[i] = -1;
+	}
+
+	sigset_t signals;
+	sigemptyset(&signals);
+
+	for (u8 i = 0; i < LOOP_SIGNALS_LEN; ++i)
+	{
+		sigaddset(&signals, loop_signals[i]);
+	}
+
+	sigset_t blocked = signals;
+	sigaddset(&blocked, SIGWINCH);
+	sigprocmask(SIG_BLOCK, &blocked, &original_mask);
+
+	// only the terminal resize gets through while waiting
+	loop->wait_mask = original_mask;
+	sigdelset(&loop->wait_mask, SIGWINCH);
+
+	// termbox reads the terminal on its own file descriptor,
+	// this one is only used to know when input is available
+	loop->fds[LOOP_TTY] = open("/dev/tty", O_RDONLY | O_NOCTTY | O_CLOEXEC);
+
+	if (loop->fds[LOOP_TTY] < 0)
+	{
+		loop->fds[LOOP_TTY] = dup(STDIN_FILENO);
+	}
+
+#if defined(__linux__)
+	for (u8 i = 0; i < LOOP_SIGNALS_LEN; ++i)
+	{
+		sigaddset(&loop->wait_mask, loop_signals[i]);
+	}
+
+	loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	loop->fds[LOOP_SIGNALS] =
+		signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+	loop->fds[LOOP_TIMER] =
+		timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	loop->fds[LOOP_WATCH] = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if ((loop->epoll_fd < 0)
+		|| (loop->fds[LOOP_TTY] < 0)
+		|| (loop->fds[LOOP_SIGNALS] < 0)
+		|| (loop->fds[LOOP_TIMER] < 0))
+	{
+		loop_free(loop);
+		dgn_throw(DGN_LOOP);
+		return;
+	}
+
+	struct epoll_event event = {0};
+	event.events = EPOLLIN;
+
+	for (u8 i = 0; i < LOOP_COUNT; ++i)
+	{
+		// file watches are a nice-to-have
+		if (loop->fds[i] < 0)
+		{
+			continue;
+		}
+
+		event.data.u32 = i;
+		epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->fds[i], &event);
+	}
+#else
+	struct sigaction action = {0};
+	action.sa_handler = loop_flag;
+	sigemptyset(&action.sa_mask);
+
+	for (u8 i = 0; i < LOOP_SIGNALS_LEN; ++i)
+	{
+		pending[i] = 0;
+		sigaction(loop_signals[i], &action, NULL);
+		sigdelset(&loop->wait_mask, loop_signals[i]);
+	}
+
+	if (loop->fds[LOOP_TTY] < 0)
+	{
+		loop_free(loop);
+		dgn_throw(DGN_LOOP);
+		return;
+	}
+#endif
+}
+
+void loop_free(struct loop* loop)
+{
+	for (u8 i = 0; i < LOOP_COUNT; ++i)
+	{
+		if ((i != LOOP_HELPER) && (loop->fds[i] >= 0))
+		{
+			close(loop->fds[i]);
+			loop->fds[i] = -1;
+		}
+	}
+
+	if (loop->epoll_fd >= 0)
+	{
+		close(loop->epoll_fd);
+		loop->epoll_fd = -1;
+	}
+
+	sigprocmask(SIG_SETMASK, &original_mask, NULL);
+}
+
+// reports changes to the entries of a folder
+void loop_watch(struct loop* loop, char* path)
+{
+#if defined(__linux__)
+	if (loop->fds[LOOP_WATCH] < 0)
+	{
+		return;
+	}
+
+	inotify_add_watch(
+		loop->fds[LOOP_WATCH],
+		path,
+		IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE);
+#endif
+}
+
+// wakes the loop up at the given monotonic time, or never when zero
+void loop_timer(struct loop* loop, u64 deadline)
+{
+	if (deadline == loop->deadline)
+	{
+		return;
+	}
+
+	loop->deadline = deadline;
+
+#if defined(__linux__)
+	struct itimerspec spec = {0};
+	spec.it_value.tv_sec = deadline / NSEC_PER_SEC;
+	spec.it_value.tv_nsec = deadline % NSEC_PER_SEC;
+
+	timerfd_settime(loop->fds[LOOP_TIMER], TFD_TIMER_ABSTIME, &spec, NULL);
+#endif
+}
+
+// also reports when the given descriptor is readable,
+// until called again with a negative one
+void loop_helper(struct loop* loop, int fd)
+{
+#if defined(__linux__)
+	if (loop->fds[LOOP_HELPER] >= 0)
+	{
+		epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, loop->fds[LOOP_HELPER], NULL);
+	}
+
+	if (fd >= 0)
+	{
+		struct epoll_event event = {0};
+		event.events = EPOLLIN;
+		event.data.u32 = LOOP_HELPER;
+		epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	}
+#endif
+
+	loop->fds[LOOP_HELPER] = fd;
+}
+
+#if defined(__linux__)
+static void loop_dispatch(struct loop* loop, u32 source)
+{
+	const struct loop_handlers* handlers = loop->handlers;
+	int fd = loop->fds[source];
+
+	switch (source)
+	{
+		case LOOP_TTY:
+		{
+			if (handlers->input != NULL)
+			{
+				handlers->input(loop->data);
+			}
+
+			break;
+		}
+		case LOOP_SIGNALS:
+		{
+			struct signalfd_siginfo info;
+
+			while (read(fd, &info, sizeof (info)) == sizeof (info))
+			{
+				if (handlers->signal != NULL)
+				{
+					handlers->signal(loop->data, info.ssi_signo);
+				}
+			}
+
+			break;
+		}
+		case LOOP_TIMER:
+		{
+			u64 expirations;
+
+			if (read(fd, &expirations, sizeof (u64)) != sizeof (u64))
+			{
+				break;
+			}
+
+			// the timer must be armed again, even for the same deadline
+			loop->deadline = 0;
+
+			if (handlers->timer != NULL)
+			{
+				handlers->timer(loop->data);
+			}
+
+			break;
+		}
+		case LOOP_WATCH:
+		{
+			// the events are coalesced, only their presence matters
+			char events[4096];
+			bool changed = false;
+
+			while (read(fd, events, sizeof (events)) > 0)
+			{
+				changed = true;
+			}
+
+			if (changed && (handlers->watch != NULL))
+			{
+				handlers->watch(loop->data);
+			}
+
+			break;
+		}
+		case LOOP_HELPER:
+		{
+			if (handlers->helper != NULL)
+			{
+				handlers->helper(loop->data);
+			}
+
+			break;
+		}
+	}
+}
+
+void loop_wait(struct loop* loop)
+{
+	struct epoll_event events[LOOP_COUNT];
+
+	int count = epoll_pwait(
+		loop->epoll_fd,
+		events,
+		LOOP_COUNT,
+		-1,
+		&loop->wait_mask);
+
+	// interrupted by a resize, which termbox reports as input
+	if ((count < 0) && (errno == EINTR) && (loop->handlers->input != NULL))
+	{
+		loop->handlers->input(loop->data);
+	}
+
+	for (int i = 0; i < count; ++i)
+	{
+		loop_dispatch(loop, events[i].data.u32);
+	}
+}
+#else
+void loop_wait(struct loop* loop)
+{
+	const struct loop_handlers* handlers = loop->handlers;
+	struct pollfd fds[2] =
+	{
+		{loop->fds[LOOP_TTY], POLLIN, 0},
+		{loop->fds[LOOP_HELPER], POLLIN, 0},
+	};
+	struct timespec timeout;
+	struct timespec* timeout_ptr = NULL;
+
+	if (loop->deadline != 0)
+	{
+		u64 now = time_mono();
+		u64 left = (loop->deadline > now) ? (loop->deadline - now) : 0;
+
+		timeout.tv_sec = left / NSEC_PER_SEC;
+		timeout.tv_nsec = left % NSEC_PER_SEC;
+		timeout_ptr = &timeout;
+	}
+
+	// negative descriptors are ignored by poll
+	int count = ppoll(fds, 2, timeout_ptr, &loop->wait_mask);
+
+	if ((count < 0) && (errno == EINTR))
+	{
+		for (u8 i = 0; i < LOOP_SIGNALS_LEN; ++i)
+		{
+			if (pending[i] && (handlers->signal != NULL))
+			{
+				pending[i] = 0;
+				handlers->signal(loop->data, loop_signals[i]);
+			}
+		}
+
+		// or by a resize, which termbox reports as input
+		if (handlers->input != NULL)
+		{
+			handlers->input(loop->data);
+		}
+	}
+	else if (count > 0)
+	{
+		if ((fds[0].revents != 0) && (handlers->input != NULL))
+		{
+			handlers->input(loop->data);
+		}
+
+		if ((fds[1].revents != 0) && (handlers->helper != NULL))
+		{
+			handlers->helper(loop->data);
+		}
+	}
+	else if (count == 0)
+	{
+		loop->deadline = 0;
+
+		if (handlers->timer != NULL)
+		{
+			handlers->timer(loop->data);
+		}
+	}
+}
+#endif
+
+// forked children must not inherit the signals blocked for the loop
+void loop_child()
+{
+	sigprocmask(SIG_SETMASK, &original_mask, NULL);
+}
@@ -0,0 +1,51 @@
+#ifndef H_LY_LOOP
+#define H_LY_LOOP
+
+#include "ctypes.h"
+
+#include <signal.h>
+
+enum loop_sources
+{
+	LOOP_TTY,
+	LOOP_SIGNALS,
+	LOOP_TIMER,
+	LOOP_WATCH,
+	// owned by the caller, see loop_helper
+	LOOP_HELPER,
+	LOOP_COUNT,
+};
+
+// all the handlers are optional
+struct loop_handlers
+{
+	void (*input)(void* data);
+	void (*signal)(void* data, int signal);
+	void (*timer)(void* data);
+	void (*watch)(void* data);
+	void (*helper)(void* data);
+};
+
+struct loop
+{
+	const struct loop_handlers* handlers;
+	void* data;
+	int fds[LOOP_COUNT];
+	int epoll_fd;
+	// signals delivered only while waiting
+	sigset_t wait_mask;
+	u64 deadline;
+};
+
+void loop_init(
+	struct loop* loop,
+	const struct loop_handlers* handlers,
+	void* data);
+void loop_free(struct loop* loop);
+void loop_watch(struct loop* loop, char* path);
+void loop_timer(struct loop* loop, u64 deadline);
+void loop_helper(struct loop* loop, int fd);
+void loop_wait(struct loop* loop);
+void loop_child();
+
+#endif
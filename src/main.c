@@ -4,23 +4,44 @@
 #include "termbox.h"
 #include "ctypes.h"
 
+#include "clock.h"
 #include "draw.h"
 #include "inputs.h"
 #include "login.h"
+#include "loop.h"
 #include "utils.h"
 #include "config.h"
+#include "profile.h"
+#include "record.h"
+#include "timer.h"
 
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
 #include <unistd.h>
-#include <stdlib.h>
 
-#define ARG_COUNT 7
+#define ARG_COUNT 11
+// failed logins before the lockout
+#define LOCKOUT_FAILS 10
+#define LOCKOUT_DELAY (7 * NSEC_PER_SEC)
+#define CASCADE_PERIOD (10 * NSEC_PER_MSEC)
+#define AUTH_SPINNER_PERIOD (100 * NSEC_PER_MSEC)
+// virtual time at which a replay starts
+#define REPLAY_START NSEC_PER_SEC
 // things you can define:
 // GIT_VERSION_STRING
 
+// after too many failed logins the screen crumbles down,
+// then input is refused until the cooldown is over
+enum lockout
+{
+	LOCKOUT_NONE,
+	LOCKOUT_CASCADE,
+	LOCKOUT_COOLDOWN,
+};
+
 // global
 struct lang lang;
 struct config config;
@@ -62,6 +83,11 @@ void log_init(char** log)
 	log[DGN_USER_UID] = lang.err_user_uid;
 	log[DGN_PAM] = lang.err_pam;
 	log[DGN_HOSTNAME] = lang.err_hostname;
+	log[DGN_LOOP] = lang.err_loop;
+	log[DGN_RECORD] = lang.err_record;
+	log[DGN_XORG] = lang.err_xorg;
+	log[DGN_XAUTH] = lang.err_xauth;
+	log[DGN_EXEC] = lang.err_exec;
 }
 
 void arg_config(void* data, char** pars, const int pars_count)
@@ -69,6 +95,724 @@ void arg_config(void* data, char** pars, const int pars_count)
 	*((char **)data) = *pars;
 }
 
+struct greeter
+{
+	struct term_buf buf;
+	struct desktop desktop;
+	struct text login;
+	struct text password;
+	void* input_structs[3];
+	void (*input_handles[3]) (void*, struct tb_event*);
+	u8 active_input;
+
+	bool run;
+	bool reboot;
+	bool shutdown;
+	u8 auth_fails;
+	enum lockout lockout;
+	struct timer lockout_timer;
+	bool idle;
+	u64 idle_start;
+
+	struct record record;
+	bool replaying;
+
+	// the login is checked by a helper process meanwhile
+	struct loop* loop;
+	struct auth auth;
+	bool authenticating;
+	bool prompting;
+	u64 auth_deadline;
+	struct timer auth_spinner;
+	u8 auth_frame;
+	char auth_line[AUTH_TEXT_LEN + 2];
+};
+
+// shows the progress of the login on the info line
+static void greeter_spin(struct greeter* greeter)
+{
+	static const char frames[] = "|/-\\";
+	char* text = (greeter->auth.message[0] != '\0')
+		? greeter->auth.message
+		: lang.authenticating;
+
+	snprintf(
+		greeter->auth_line,
+		sizeof (greeter->auth_line),
+		"%c %s",
+		frames[greeter->auth_frame % 4],
+		text);
+
+	greeter->buf.info_line = greeter->auth_line;
+	damage(&greeter->buf, WIDGET_INFO_LINE);
+}
+
+// the pam stack gets auth_timeout seconds for every step it takes
+static void greeter_auth_wait(struct greeter* greeter)
+{
+	greeter->auth_deadline = 0;
+
+	if (config.auth_timeout > 0)
+	{
+		greeter->auth_deadline =
+			time_mono() + (config.auth_timeout * NSEC_PER_SEC);
+	}
+}
+
+// gives up on the login, the helper closes what it already opened
+static void greeter_auth_stop(struct greeter* greeter, char* reason)
+{
+	auth_cancel(&greeter->auth);
+	greeter->authenticating = false;
+	greeter->prompting = false;
+	greeter->active_input = PASSWORD_INPUT;
+	greeter->buf.info_line = reason;
+	damage_all(&greeter->buf);
+}
+
+// updates the screen for everything that happened since the last wait
+static void greeter_frame(struct greeter* greeter)
+{
+	struct term_buf* buf = &greeter->buf;
+	bool drawn;
+
+	if (greeter->authenticating && !greeter->prompting)
+	{
+		u64 now = time_mono();
+
+		if ((greeter->auth_deadline != 0) && (now >= greeter->auth_deadline))
+		{
+			greeter_auth_stop(greeter, lang.err_auth_timeout);
+		}
+		else if (timer_ticks(&greeter->auth_spinner, now, 1) > 0)
+		{
+			++greeter->auth_frame;
+			greeter_spin(greeter);
+		}
+	}
+
+	if ((greeter->lockout == LOCKOUT_COOLDOWN)
+		&& (timer_ticks(&greeter->lockout_timer, time_mono(), 1) > 0))
+	{
+		greeter->lockout = LOCKOUT_NONE;
+		greeter->auth_fails = 0;
+		damage_all(buf);
+	}
+
+	// suspend the animation when nobody used the greeter for a while
+	if (!greeter->idle
+		&& !greeter->authenticating
+		&& (greeter->lockout == LOCKOUT_NONE)
+		&& (config.idle_timeout > 0)
+		&& (time_mono() >= greeter->idle_start))
+	{
+		greeter->idle = true;
+		status_idle(&buf->status, true, time_mono());
+
+		if (config.idle_blank)
+		{
+			blank_console(buf, true);
+		}
+	}
+
+	u32 changed;
+	PROFILED(PROFILE_STATUS, changed = poll_status(buf, time_mono()));
+
+	if (changed != 0)
+	{
+		record_status(
+			&greeter->record,
+			status_snapshot(&buf->status),
+			time_mono());
+	}
+
+	if (greeter->lockout == LOCKOUT_NONE)
+	{
+		if (!greeter->idle)
+		{
+			PROFILED(PROFILE_STEP, animate_tick(buf, time_mono()));
+		}
+
+		PROFILED(
+			PROFILE_DRAW,
+			drawn = draw_damaged(
+				buf,
+				&greeter->desktop,
+				&greeter->login,
+				&greeter->password));
+
+		if (drawn)
+		{
+			PROFILED(PROFILE_PRESENT, tb_present());
+			profile_keys_presented();
+		}
+
+		// the failure message is shown before crumbling down
+		if (greeter->auth_fails >= LOCKOUT_FAILS)
+		{
+			greeter->lockout = LOCKOUT_CASCADE;
+			timer_init(&greeter->lockout_timer, CASCADE_PERIOD, time_mono());
+		}
+	}
+	else if ((greeter->lockout == LOCKOUT_CASCADE)
+		&& (timer_ticks(&greeter->lockout_timer, time_mono(), 1) > 0))
+	{
+		if (cascade(buf))
+		{
+			tb_present();
+		}
+		else
+		{
+			greeter->lockout = LOCKOUT_COOLDOWN;
+			timer_init(&greeter->lockout_timer, LOCKOUT_DELAY, time_mono());
+		}
+	}
+
+	// keys which changed nothing on screen are not traced, instead of
+	// being charged the wait until an unrelated frame
+	profile_keys_discard();
+}
+
+// milliseconds until the next status poll, animation frame or
+// lockout step, negative when only an event can change the screen
+static int greeter_timeout(struct greeter* greeter, u64 now)
+{
+	int timeout = status_timeout(&greeter->buf.status, now);
+
+	if (greeter->lockout != LOCKOUT_NONE)
+	{
+		return timer_timeout(&greeter->lockout_timer, now);
+	}
+
+	// the user answering a prompt has all the time needed
+	if (greeter->authenticating && !greeter->prompting)
+	{
+		int auth_timeout = timer_timeout(&greeter->auth_spinner, now);
+
+		if (greeter->auth_deadline != 0)
+		{
+			int deadline_timeout = 0;
+
+			if (greeter->auth_deadline > now)
+			{
+				deadline_timeout = (greeter->auth_deadline - now
+					+ NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+			}
+
+			if (deadline_timeout < auth_timeout)
+			{
+				auth_timeout = deadline_timeout;
+			}
+		}
+
+		if ((timeout < 0) || (auth_timeout < timeout))
+		{
+			timeout = auth_timeout;
+		}
+	}
+
+	if (greeter->idle)
+	{
+		// a blank console has nothing to refresh, but the clock
+		// must keep ticking when it is visible
+		return config.idle_blank ? -1 : timeout;
+	}
+
+	if (config.idle_timeout > 0)
+	{
+		int idle_timeout = 0;
+
+		if (greeter->idle_start > now)
+		{
+			idle_timeout =
+				(greeter->idle_start - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+		}
+
+		if ((timeout < 0) || (idle_timeout < timeout))
+		{
+			timeout = idle_timeout;
+		}
+	}
+
+	if (config.animate)
+	{
+		int frame_timeout = animate_timeout(&greeter->buf, now);
+
+		if ((frame_timeout >= 0)
+			&& (frame_timeout < config.min_refresh_delta))
+		{
+			frame_timeout = config.min_refresh_delta;
+		}
+
+		if ((frame_timeout >= 0)
+			&& ((timeout < 0) || (frame_timeout < timeout)))
+		{
+			timeout = frame_timeout;
+		}
+	}
+
+	return timeout;
+}
+
+// after a failed login, or the end of the session
+static void greeter_logged(struct greeter* greeter)
+{
+	struct term_buf* buf = &greeter->buf;
+
+	// termbox was restarted or the inputs were reset
+	damage_all(buf);
+
+	if (dgn_catch())
+	{
+		++greeter->auth_fails;
+		// move focus back to password input
+		greeter->active_input = PASSWORD_INPUT;
+
+		if (dgn_output_code() != DGN_PAM)
+		{
+			buf->info_line = dgn_output_log();
+		}
+
+		if (config.blank_password)
+		{
+			input_text_clear(&greeter->password);
+		}
+
+		dgn_reset();
+	}
+	else
+	{
+		buf->info_line = lang.logout;
+	}
+
+	load(&greeter->desktop, &greeter->login);
+
+	if (!greeter->replaying)
+	{
+		system("tput cnorm");
+	}
+}
+
+static void greeter_login(struct greeter* greeter)
+{
+	struct term_buf* buf = &greeter->buf;
+
+	// the session would be counted as input latency
+	profile_keys_discard();
+	profile_warmup();
+
+	if (greeter->replaying)
+	{
+		// the passwords are not recorded, so every login
+		// fails the same way without starting anything
+		buf->info_line = lang.err_pam;
+		dgn_throw(DGN_PAM);
+		greeter_logged(greeter);
+		return;
+	}
+
+	save(&greeter->desktop, &greeter->login);
+	auth_start(
+		&greeter->auth,
+		greeter->loop,
+		&greeter->desktop,
+		&greeter->login,
+		&greeter->password);
+
+	if (dgn_catch())
+	{
+		greeter_logged(greeter);
+		return;
+	}
+
+	greeter->authenticating = true;
+	greeter->prompting = false;
+	greeter->auth_frame = 0;
+	greeter_auth_wait(greeter);
+	timer_init(&greeter->auth_spinner, AUTH_SPINNER_PERIOD, time_mono());
+	greeter_spin(greeter);
+}
+
+// while the login is checked escape cancels it, and the answers
+// to the prompts of the pam stack are typed in the password field
+static void greeter_auth_key(struct greeter* greeter, struct tb_event* event)
+{
+	struct term_buf* buf = &greeter->buf;
+
+	if (event->key == TB_KEY_ESC)
+	{
+		greeter_auth_stop(greeter, lang.err_auth_cancel);
+		return;
+	}
+
+	if (!greeter->prompting)
+	{
+		return;
+	}
+
+	if (event->key == TB_KEY_ENTER)
+	{
+		auth_answer(&greeter->auth, &greeter->password);
+		greeter->prompting = false;
+		greeter_auth_wait(greeter);
+		greeter_spin(greeter);
+	}
+	else
+	{
+		handle_text(&greeter->password, event);
+	}
+
+	damage(buf, WIDGET_PASSWORD);
+}
+
+static void greeter_event(struct greeter* greeter, struct tb_event* event)
+{
+	struct term_buf* buf = &greeter->buf;
+	u8* active_input = &greeter->active_input;
+
+	if (event->type == TB_EVENT_KEY)
+	{
+		if (greeter->lockout == LOCKOUT_NONE)
+		{
+			profile_key();
+		}
+
+		greeter->idle_start =
+			time_mono() + (config.idle_timeout * NSEC_PER_SEC);
+
+		// the key waking the greeter up is not forwarded
+		if (greeter->idle)
+		{
+			greeter->idle = false;
+			status_idle(&buf->status, false, time_mono());
+
+			if (config.idle_blank)
+			{
+				blank_console(buf, false);
+			}
+
+			damage_all(buf);
+			return;
+		}
+	}
+
+	if (event->type == TB_EVENT_RESIZE)
+	{
+		// the caches are rebuilt for the new size
+		profile_warmup();
+		damage_all(buf);
+	}
+
+	// keys typed during the lockout are dropped
+	if ((greeter->lockout != LOCKOUT_NONE) || (event->type != TB_EVENT_KEY))
+	{
+		return;
+	}
+
+	// the lock keys do not generate events of their own
+	status_refresh(&buf->status, STATUS_LEDS);
+
+	if (greeter->authenticating)
+	{
+		greeter_auth_key(greeter, event);
+		return;
+	}
+
+	switch (event->key)
+	{
+	case TB_KEY_F1:
+		greeter->shutdown = true;
+		greeter->run = false;
+		break;
+	case TB_KEY_F2:
+		greeter->reboot = true;
+		greeter->run = false;
+		break;
+	case TB_KEY_CTRL_C:
+		greeter->run = false;
+		break;
+	case TB_KEY_CTRL_U:
+		if (*active_input > 0)
+		{
+			input_text_clear(greeter->input_structs[*active_input]);
+			damage(buf, WIDGET_DESKTOP + *active_input);
+		}
+		break;
+	case TB_KEY_ARROW_UP:
+		if (*active_input > 0)
+		{
+			--*active_input;
+			damage(buf, WIDGET_DESKTOP + *active_input);
+		}
+		break;
+	case TB_KEY_ARROW_DOWN:
+		if (*active_input < 2)
+		{
+			++*active_input;
+			damage(buf, WIDGET_DESKTOP + *active_input);
+		}
+		break;
+	case TB_KEY_TAB:
+		++*active_input;
+
+		if (*active_input > 2)
+		{
+			*active_input = PASSWORD_INPUT;
+		}
+		damage(buf, WIDGET_DESKTOP + *active_input);
+		break;
+	case TB_KEY_ENTER:
+		greeter_login(greeter);
+		break;
+	default:
+		(*greeter->input_handles[*active_input])(
+			greeter->input_structs[*active_input],
+			event);
+		damage(buf, WIDGET_DESKTOP + *active_input);
+		break;
+	}
+}
+
+// loop handlers
+
+// applies every queued event before the next frame is drawn,
+// so a paste or a repeated key only costs a single redraw
+static void on_input(void* data)
+{
+	struct greeter* greeter = data;
+	struct tb_event event;
+	u32 events = 0;
+
+	while (greeter->run && (tb_peek_event(&event, 0) > 0))
+	{
+		record_event(
+			&greeter->record,
+			&event,
+			greeter->active_input == PASSWORD_INPUT,
+			time_mono());
+		greeter_event(greeter, &event);
+		++events;
+	}
+
+	if (events > 0)
+	{
+		profile_record(PROFILE_INPUT_BATCH, events);
+	}
+}
+
+static void on_signal(void* data, int signal)
+{
+	struct greeter* greeter = data;
+	pid_t pid;
+	int status;
+
+	switch (signal)
+	{
+		case SIGTERM:
+		case SIGHUP:
+		{
+			greeter->run = false;
+			break;
+		}
+		case SIGCHLD:
+		{
+			// the sessions are waited for synchronously, anything left
+			// here is a stray child or the helper, which is only marked
+			// as gone so that its pid is never killed nor waited again
+			while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+			{
+				if (pid == greeter->auth.pid)
+				{
+					greeter->auth.pid = -1;
+				}
+			}
+
+			break;
+		}
+		case SIGUSR1:
+		{
+			profile_dump();
+			break;
+		}
+	}
+}
+
+static void on_helper(void* data)
+{
+	struct greeter* greeter = data;
+	struct term_buf* buf = &greeter->buf;
+
+	enum auth_status status = auth_read(
+		&greeter->auth,
+		&greeter->desktop,
+		&greeter->password,
+		buf);
+
+	switch (status)
+	{
+		case AUTH_PENDING:
+		{
+			greeter_spin(greeter);
+			break;
+		}
+		case AUTH_PROMPT:
+		{
+			greeter->prompting = true;
+			greeter->active_input = PASSWORD_INPUT;
+			input_text_clear(&greeter->password);
+			damage(buf, WIDGET_INFO_LINE);
+			damage(buf, WIDGET_PASSWORD);
+			break;
+		}
+		case AUTH_FINISHED:
+		{
+			greeter->authenticating = false;
+			greeter->prompting = false;
+			greeter_logged(greeter);
+			break;
+		}
+	}
+}
+
+// keeps the selected session when the list is reloaded
+static void on_watch(void* data)
+{
+	struct greeter* greeter = data;
+	struct desktop* desktop = &greeter->desktop;
+	char* current = strdup(desktop->list[desktop->cur]);
+
+	input_desktop_free(desktop);
+	input_desktop(desktop);
+	desktop_load(desktop);
+
+	if (dgn_catch())
+	{
+		dgn_reset();
+	}
+
+	for (u16 i = 0; (current != NULL) && (i < desktop->len); ++i)
+	{
+		if (strcmp(desktop->list[i], current) == 0)
+		{
+			desktop->cur = i;
+			break;
+		}
+	}
+
+	free(current);
+	damage(&greeter->buf, WIDGET_DESKTOP);
+}
+
+static const struct loop_handlers handlers =
+{
+	on_input,
+	on_signal,
+	NULL,
+	on_watch,
+	on_helper,
+};
+
+// FNV-1a hash of the cells on screen
+static u64 frame_checksum()
+{
+	struct tb_cell* cells = tb_cell_buffer();
+	u32 len = tb_width() * tb_height();
+	u64 hash = 0xcbf29ce484222325ULL;
+
+	for (u32 i = 0; i < len; ++i)
+	{
+		u32 values[3] = {cells[i].ch, cells[i].fg, cells[i].bg};
+
+		for (u8 k = 0; k < 12; ++k)
+		{
+			hash ^= (values[k / 4] >> (8 * (k % 4))) & 0xff;
+			hash *= 0x100000001b3ULL;
+		}
+	}
+
+	return hash;
+}
+
+// only linked in the replayer, whose screen is resized with the records
+void headless_resize(u16 width, u16 height) __attribute__((weak));
+
+// feeds the recorded entries back at their times on a virtual clock,
+// and prints the number, time and checksum of every frame
+static void greeter_replay(
+	struct greeter* greeter,
+	struct replay* replay,
+	enum replay_entries entry)
+{
+	u64 frame = 0;
+
+	while (greeter->run)
+	{
+		// everything due is applied before the frame, like on_input
+		while ((entry != REPLAY_END)
+			&& ((REPLAY_START + replay->time) <= time_mono()))
+		{
+			if (entry == REPLAY_EVENT)
+			{
+				if ((replay->event.type == TB_EVENT_RESIZE)
+					&& (headless_resize != NULL))
+				{
+					headless_resize(replay->event.w, replay->event.h);
+				}
+
+				greeter_event(greeter, &replay->event);
+			}
+			else
+			{
+				status_inject(&greeter->buf.status, &replay->status);
+				clock_force(replay->clock);
+			}
+
+			entry = replay_next(replay);
+		}
+
+		PROFILED(PROFILE_FRAME, greeter_frame(greeter));
+
+		u64 now = time_mono();
+		u64 due = REPLAY_START + replay->time;
+
+		printf(
+			"%llu %llu %016llx\n",
+			(unsigned long long) frame,
+			(unsigned long long) (now - REPLAY_START),
+			(unsigned long long) frame_checksum());
+		++frame;
+
+		if ((entry == REPLAY_END) && (now >= due))
+		{
+			break;
+		}
+
+		// the clock jumps to whatever comes first
+		int timeout = greeter_timeout(greeter, now);
+		u64 next = due;
+
+		if (timeout >= 0)
+		{
+			u64 wake = now + (((timeout > 0) ? timeout : 1) * NSEC_PER_MSEC);
+
+			if (wake < next)
+			{
+				next = wake;
+			}
+		}
+
+		if (next > now)
+		{
+			time_virtual(next);
+		}
+	}
+
+	// the recorded F1 and F2 only end the replay
+	greeter->run = false;
+	greeter->shutdown = false;
+	greeter->reboot = false;
+}
+
 // ly!
 int main(int argc, char** argv)
 {
@@ -80,12 +824,19 @@ int main(int argc, char** argv)
 	lang_defaults();
 
 	char *config_path = NULL;
+	char *seed = NULL;
+	char *record_path = NULL;
+	char *replay_path = NULL;
 	// parse args
 	const struct argoat_sprig sprigs[ARG_COUNT] =
 	{
 		{NULL, 0, NULL, NULL},
 		{"config", 0, &config_path, arg_config},
 		{"c", 0, &config_path, arg_config},
+		{"seed", 0, &seed, arg_config},
+		{"s", 0, &seed, arg_config},
+		{"record", 0, &record_path, arg_config},
+		{"replay", 0, &replay_path, arg_config},
 		{"help", 0, NULL, arg_help},
 		{"h", 0, NULL, arg_help},
 		{"version", 0, NULL, arg_version},
@@ -103,12 +854,11 @@ int main(int argc, char** argv)
 	}
 
 	// init inputs
-	struct desktop desktop;
-	struct text login;
-	struct text password;
-	input_desktop(&desktop);
-	input_text(&login, config.max_login_len);
-	input_text(&password, config.max_password_len);
+	struct greeter greeter;
+	struct term_buf* buf = &greeter.buf;
+	input_desktop(&greeter.desktop);
+	input_text(&greeter.login, config.max_login_len);
+	input_text(&greeter.password, config.max_password_len);
 
 	if (dgn_catch())
 	{
@@ -119,27 +869,66 @@ int main(int argc, char** argv)
 
 	config_load(config_path);
 
+	if (seed != NULL)
+	{
+		config.seed = strtoul(seed, NULL, 10);
+	}
+
 	if (strcmp(config.lang, "en") != 0)
 	{
 		lang_load();
 	}
 
-	void* input_structs[3] =
+	clock_init();
+
+	struct replay replay;
+	greeter.replaying = replay_path != NULL;
+	greeter.record.file = NULL;
+
+	if (greeter.replaying)
 	{
-		(void*) &desktop,
-		(void*) &login,
-		(void*) &password,
-	};
+		replay_open(&replay, replay_path);
+
+		if (dgn_catch())
+		{
+			fprintf(stderr, "%s\n", dgn_output_log());
+			input_desktop_free(&greeter.desktop);
+			input_text_free(&greeter.login);
+			input_text_free(&greeter.password);
+			config_free();
+			lang_free();
+			return 1;
+		}
+
+		// the saved login and the console must not change the frames
+		config.seed = replay.seed;
+		config.load = false;
+		config.save = false;
+		config.idle_blank = false;
+		time_virtual(REPLAY_START);
 
-	void (*input_handles[3]) (void*, struct tb_event*) =
+		// only used when the terminal cannot be queried, like offscreen
+		char size[8];
+		snprintf(size, (sizeof size), "%u", replay.width);
+		setenv("COLUMNS", size, 1);
+		snprintf(size, (sizeof size), "%u", replay.height);
+		setenv("LINES", size, 1);
+	}
+	else if ((record_path != NULL) && (config.seed == 0))
 	{
-		handle_desktop,
-		handle_text,
-		handle_text,
-	};
+		// the animations are reproduced from the recorded seed
+		config.seed = time_mono();
+	}
+
+	greeter.input_structs[SESSION_SWITCH] = &greeter.desktop;
+	greeter.input_structs[LOGIN_INPUT] = &greeter.login;
+	greeter.input_structs[PASSWORD_INPUT] = &greeter.password;
+	greeter.input_handles[SESSION_SWITCH] = handle_desktop;
+	greeter.input_handles[LOGIN_INPUT] = handle_text;
+	greeter.input_handles[PASSWORD_INPUT] = handle_text;
 
-	desktop_load(&desktop);
-	load(&desktop, &login);
+	desktop_load(&greeter.desktop);
+	load(&greeter.desktop, &greeter.login);
 
 	/* By now, TTY2 has been selected */
 
@@ -150,19 +939,40 @@ int main(int argc, char** argv)
 	tb_clear();
 
 	// init visible elements
-	struct tb_event event;
-	struct term_buf buf;
-	u8 active_input = config.default_input;
+	greeter.active_input = config.default_input;
+
+	position_input(buf, &greeter.desktop, &greeter.login, &greeter.password);
+	(*greeter.input_handles[greeter.active_input])(
+		greeter.input_structs[greeter.active_input],
+		NULL);
+
+	// init drawing stuff; a replay never looks at the machine, it starts
+	// from the status recorded along with the first frame
+	struct status replay_status = {0};
+	enum replay_entries replay_entry = REPLAY_END;
+
+	if (greeter.replaying)
+	{
+		replay_status.battery = -1;
+		replay_entry = replay_next(&replay);
 
-	position_input(&buf, &desktop, &login, &password);
-	(*input_handles[active_input])(input_structs[active_input], NULL);
+		if (replay_entry == REPLAY_STATUS)
+		{
+			replay_status = replay.status;
+			clock_force(replay.clock);
+			replay_entry = replay_next(&replay);
+		}
 
-	// init drawing stuff
-	draw_init(&buf);
+		draw_init(buf, &replay_status);
+	}
+	else
+	{
+		draw_init(buf, NULL);
+	}
 
 	if (config.animate)
 	{
-		animate_init(&buf);
+		animate_init(buf);
 
 		if (dgn_catch())
 		{
@@ -172,155 +982,110 @@ int main(int argc, char** argv)
 	}
 
 	// init state info
-	int error;
-	bool run = true;
-	bool update = true;
-	bool reboot = false;
-	bool shutdown = false;
-	u8 auth_fails = 0;
-
-	switch_tty(&buf);
+	greeter.run = true;
+	greeter.reboot = false;
+	greeter.shutdown = false;
+	greeter.auth_fails = 0;
+	greeter.lockout = LOCKOUT_NONE;
+	greeter.idle = false;
+	greeter.authenticating = false;
+	greeter.prompting = false;
+	greeter.idle_start = time_mono() + (config.idle_timeout * NSEC_PER_SEC);
 
-	// main loop
-	while (run)
+	if (record_path != NULL)
 	{
-		if (update)
-		{
-			if (auth_fails < 10)
-			{
-				tb_clear();
-				animate(&buf);
-				draw_box(&buf);
-				draw_labels(&buf);
-				draw_info_bar(&buf);
-				draw_lock_state(&buf);
-				position_input(&buf, &desktop, &login, &password);
-				draw_desktop(&desktop);
-				draw_input(&login);
-				draw_input_mask(&password);
-				update = config.animate;
-
-			}
-			else
-			{
-				usleep(10000);
-				update = cascade(&buf, &auth_fails);
-			}
+		record_open(
+			&greeter.record,
+			record_path,
+			config.seed,
+			tb_width(),
+			tb_height(),
+			time_mono());
 
-			tb_present();
+		if (dgn_catch())
+		{
+			buf->info_line = dgn_output_log();
+			dgn_reset();
 		}
-
-		error = tb_peek_event(&event, config.min_refresh_delta);
-
-		if (error < 0)
+		else
 		{
-			continue;
+			// shown by the first frame, so recorded at its start
+			record_status(
+				&greeter.record,
+				status_snapshot(&buf->status),
+				greeter.record.start);
 		}
+	}
 
-		if (event.type == TB_EVENT_KEY)
-		{
-			switch (event.key)
-			{
-			case TB_KEY_F1:
-				shutdown = true;
-				run = false;
-				break;
-			case TB_KEY_F2:
-				reboot = true;
-				run = false;
-				break;
-			case TB_KEY_CTRL_C:
-				run = false;
-				break;
-			case TB_KEY_CTRL_U:
-				if (active_input > 0)
-				{
-					input_text_clear(input_structs[active_input]);
-				}
-				break;
-			case TB_KEY_ARROW_UP:
-				if (active_input > 0)
-				{
-					--active_input;
-					update = true;
-				}
-				break;
-			case TB_KEY_ARROW_DOWN:
-				if (active_input < 2)
-				{
-					++active_input;
-					update = true;
-				}
-				break;
-			case TB_KEY_TAB:
-				++active_input;
+	if (!greeter.replaying)
+	{
+		switch_tty(buf);
+	}
 
-				if (active_input > 2)
-				{
-					active_input = PASSWORD_INPUT;
-				}
-				update = true;
-				break;
-			case TB_KEY_ENTER:
-				save(&desktop, &login);
-				auth(&desktop, &login, &password, &buf);
-				update = true;
-
-				if (dgn_catch())
-				{
-					++auth_fails;
-					// move focus back to password input
-					active_input = PASSWORD_INPUT;
+	struct loop loop;
+	greeter.loop = &loop;
+	loop_init(&loop, &handlers, &greeter);
 
-					if (dgn_output_code() != DGN_PAM)
-					{
-						buf.info_line = dgn_output_log();
-					}
+	if (dgn_catch())
+	{
+		greeter.run = false;
+		dgn_reset();
+	}
+	else
+	{
+		// the sessions list follows the installed desktops
+		loop_watch(&loop, config.xsessions);
+		loop_watch(&loop, config.waylandsessions);
+	}
 
-					if (config.blank_password)
-					{
-						input_text_clear(&password);
-					}
+	if (greeter.replaying)
+	{
+		greeter_replay(&greeter, &replay, replay_entry);
+		replay_close(&replay);
+	}
 
-					dgn_reset();
-				}
-				else
-				{
-					buf.info_line = lang.logout;
-				}
+	// main loop
+	while (greeter.run)
+	{
+		PROFILED(PROFILE_FRAME, greeter_frame(&greeter));
 
-				load(&desktop, &login);
-				system("tput cnorm");
-				break;
-			default:
-				(*input_handles[active_input])(
-					input_structs[active_input],
-					&event);
-				update = true;
-				break;
-			}
-		}
+		u64 now = time_mono();
+		int timeout = greeter_timeout(&greeter, now);
+
+		loop_timer(
+			&loop,
+			(timeout < 0) ? 0 : now + (timeout * NSEC_PER_MSEC));
+		loop_wait(&loop);
 	}
 
+	if (greeter.authenticating)
+	{
+		auth_cancel(&greeter.auth);
+	}
+
+	profile_dump();
+	record_close(&greeter.record, time_mono());
+
 	// stop termbox
 	tb_shutdown();
 
 	// free inputs
-	input_desktop_free(&desktop);
-	input_text_free(&login);
-	input_text_free(&password);
-	free_hostname();
+	input_desktop_free(&greeter.desktop);
+	input_text_free(&greeter.login);
+	input_text_free(&greeter.password);
 
 	// unload config
-	draw_free(&buf);
+	draw_free(buf);
+	// the shutdown commands get the original signal mask back
+	loop_free(&loop);
 	lang_free();
 
-	if (shutdown)
+	if (greeter.shutdown)
 	{
 		execl("/bin/sh", "sh", "-c", config.shutdown_cmd, NULL);
 	}
 
-	if (reboot)
+	if (greeter.reboot)
 	{
 		execl("/bin/sh", "sh", "-c", config.restart_cmd, NULL);
 	}
@@ -0,0 +1,335 @@
+#include "dragonfail.h"
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "animation.h"
+#include "prng.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// drops falling at the same time in a column
+#define MATRIX_DROPS 4
+// glyphs per column, repeated along its height
+#define MATRIX_RING 32
+// cell updates kept between two renders, per column
+#define MATRIX_CHANGES (3 * MATRIX_DROPS * 4)
+
+struct drop
+{
+	i32 head;
+	u16 len;
+	u8 offset;
+	bool active;
+};
+
+// the drops of a column move one row every speed steps
+struct column
+{
+	struct drop drops[MATRIX_DROPS];
+	u8 speed;
+	u8 wait;
+	u8 ring[MATRIX_RING];
+};
+
+struct change
+{
+	u32 index;
+	u8 ch;
+	u8 fg;
+};
+
+struct matrix
+{
+	struct column* columns;
+	struct change* changes;
+	u32 changes_len;
+	u32 changes_max;
+	bool full;
+
+	u8* rand_buf;
+	u32 width;
+	u32 height;
+	struct prng prng;
+};
+
+static void column_init(struct matrix* matrix, struct column* column)
+{
+	memset(column->drops, 0, sizeof (column->drops));
+	column->speed = 1;
+	column->wait = 0;
+
+	for (u8 i = 0; i < MATRIX_RING; ++i)
+	{
+		column->ring[i] = (prng_next(&matrix->prng) % 94) + 33;
+	}
+}
+
+// moves the rain to the new size, keeping the columns still on screen
+static void matrix_resize(void* state, u16 width, u16 height) // throws
+{
+	struct matrix* matrix = state;
+	u32 changes_max = MATRIX_CHANGES * width;
+
+	struct column* columns = malloc((sizeof (struct column)) * width);
+	struct change* changes = malloc((sizeof (struct change)) * changes_max);
+	u8* rand_buf = realloc(matrix->rand_buf, 2 * width);
+
+	if (rand_buf != NULL)
+	{
+		matrix->rand_buf = rand_buf;
+	}
+
+	if ((columns == NULL) || (changes == NULL) || (rand_buf == NULL))
+	{
+		free(columns);
+		free(changes);
+		dgn_throw(DGN_ALLOC);
+		return;
+	}
+
+	u32 copy_width = (width < matrix->width) ? width : matrix->width;
+
+	if (matrix->columns != NULL)
+	{
+		memcpy(columns, matrix->columns, (sizeof (struct column)) * copy_width);
+	}
+
+	for (u32 x = copy_width; x < width; ++x)
+	{
+		column_init(matrix, &columns[x]);
+	}
+
+	free(matrix->columns);
+	free(matrix->changes);
+	matrix->columns = columns;
+	matrix->changes = changes;
+	matrix->changes_len = 0;
+	matrix->changes_max = changes_max;
+	matrix->full = true;
+	matrix->width = width;
+	matrix->height = height;
+}
+
+static void matrix_free(void* state)
+{
+	struct matrix* matrix = state;
+
+	free(matrix->columns);
+	free(matrix->changes);
+	free(matrix->rand_buf);
+	free(matrix);
+}
+
+static void* matrix_init(u16 width, u16 height, u64 seed) // throws
+{
+	struct matrix* matrix = malloc(sizeof (struct matrix));
+
+	if (matrix == NULL)
+	{
+		dgn_throw(DGN_ALLOC);
+		return NULL;
+	}
+
+	matrix->columns = NULL;
+	matrix->changes = NULL;
+	matrix->rand_buf = NULL;
+	matrix->width = 0;
+	matrix->height = 0;
+	prng_seed(&matrix->prng, seed);
+
+	matrix_resize(matrix, width, height);
+
+	if (matrix->columns == NULL)
+	{
+		matrix_free(matrix);
+		return NULL;
+	}
+
+	return matrix;
+}
+
+static u8 drop_glyph(struct column* column, struct drop* drop, i32 y)
+{
+	return column->ring[(drop->offset + y) % MATRIX_RING];
+}
+
+// queues a cell update for the next render, or falls back
+// to a full render when too many of them piled up
+static void matrix_change(struct matrix* matrix, u32 x, i32 y, u8 ch, u8 fg)
+{
+	if ((y < 0) || (y >= (i32) matrix->height))
+	{
+		return;
+	}
+
+	if (matrix->changes_len >= matrix->changes_max)
+	{
+		matrix->full = true;
+		return;
+	}
+
+	struct change* change = &matrix->changes[matrix->changes_len];
+	change->index = (y * matrix->width) + x;
+	change->ch = ch;
+	change->fg = fg;
+	++matrix->changes_len;
+}
+
+// the head is drawn in white over the green trail,
+// which is erased from its end as the drop falls
+static void drop_move(struct matrix* matrix, u32 x, struct drop* drop)
+{
+	struct column* column = &matrix->columns[x];
+	i32 head = ++drop->head;
+
+	matrix_change(matrix, x, head, drop_glyph(column, drop, head), 7);
+	matrix_change(matrix, x, head - 1, drop_glyph(column, drop, head - 1), 2);
+	matrix_change(matrix, x, head - drop->len, ' ', 7);
+
+	if ((head - drop->len + 1) >= (i32) matrix->height)
+	{
+		drop->active = false;
+	}
+}
+
+static void matrix_step(void* state)
+{
+	struct matrix* matrix = state;
+	struct column* column;
+	struct drop* drop;
+	struct drop* spawn;
+	bool top_free;
+	bool empty;
+
+	// two random bytes per column, for its next drop
+	u8* rand_buf = matrix->rand_buf;
+	prng_fill(&matrix->prng, rand_buf, 2 * matrix->width);
+
+	for (u32 x = 0; x < matrix->width; ++x)
+	{
+		column = &matrix->columns[x];
+
+		if (column->wait > 0)
+		{
+			--column->wait;
+			continue;
+		}
+
+		column->wait = column->speed - 1;
+		spawn = NULL;
+		top_free = true;
+		empty = true;
+
+		for (u8 i = 0; i < MATRIX_DROPS; ++i)
+		{
+			drop = &column->drops[i];
+
+			if (!drop->active)
+			{
+				spawn = drop;
+				continue;
+			}
+
+			drop_move(matrix, x, drop);
+			empty = empty && !drop->active;
+
+			// leave at least one blank cell between two drops
+			if ((drop->head - drop->len + 1) <= 1)
+			{
+				top_free = false;
+			}
+		}
+
+		if ((spawn == NULL) || !top_free || ((rand_buf[2 * x] % 16) != 0))
+		{
+			continue;
+		}
+
+		// the speed can only change when the column is empty
+		if (empty)
+		{
+			column->speed = 1 + (rand_buf[(2 * x) + 1] & 1);
+		}
+
+		spawn->active = true;
+		spawn->head = -1;
+		spawn->len = 4 + (rand_buf[(2 * x) + 1] % 28);
+		spawn->offset = prng_next(&matrix->prng) % MATRIX_RING;
+	}
+}
+
+// only the queued changes are written, unless the cells were
+// overwritten since the last render or too many changes piled up
+static void matrix_render(void* state, struct tb_cell* buf, bool full)
+{
+	struct matrix* matrix = state;
+
+	if (full || matrix->full)
+	{
+		struct tb_cell blank = {' ', 7, 0};
+		u32 len = matrix->width * matrix->height;
+
+		for (u32 i = 0; i < len; ++i)
+		{
+			buf[i] = blank;
+		}
+
+		for (u32 x = 0; x < matrix->width; ++x)
+		{
+			struct column* column = &matrix->columns[x];
+
+			for (u8 i = 0; i < MATRIX_DROPS; ++i)
+			{
+				struct drop* drop = &column->drops[i];
+
+				if (!drop->active)
+				{
+					continue;
+				}
+
+				i32 y = drop->head - drop->len + 1;
+
+				if (y < 0)
+				{
+					y = 0;
+				}
+
+				for (; (y <= drop->head) && (y < (i32) matrix->height); ++y)
+				{
+					struct tb_cell* cell = &buf[(y * matrix->width) + x];
+					cell->ch = drop_glyph(column, drop, y);
+					cell->fg = (y == drop->head) ? 7 : 2;
+				}
+			}
+		}
+
+		matrix->full = false;
+		matrix->changes_len = 0;
+
+		return;
+	}
+
+	for (u32 i = 0; i < matrix->changes_len; ++i)
+	{
+		struct change* change = &matrix->changes[i];
+		struct tb_cell* cell = &buf[change->index];
+
+		cell->ch = change->ch;
+		cell->fg = change->fg;
+		cell->bg = 0;
+	}
+
+	matrix->changes_len = 0;
+}
+
+const struct animation matrix_animation =
+{
+	"matrix",
+	40,
+	matrix_init,
+	matrix_step,
+	matrix_render,
+	matrix_resize,
+	matrix_free,
+};
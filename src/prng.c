@@ -0,0 +1,51 @@
+#include "ctypes.h"
+
+#include "prng.h"
+
+// xorshift64* generator, lock-free and cheap enough to be called per cell
+void prng_seed(struct prng* prng, u64 seed)
+{
+	// splitmix64 scrambling, so that close seeds give unrelated
+	// sequences and a zero seed still yields a valid state
+	seed += 0x9e3779b97f4a7c15ULL;
+	seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+	seed ^= seed >> 31;
+
+	prng->state = (seed != 0) ? seed : 1;
+}
+
+static u64 prng_next64(struct prng* prng)
+{
+	u64 x = prng->state;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	prng->state = x;
+
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+u32 prng_next(struct prng* prng)
+{
+	return prng_next64(prng) >> 32;
+}
+
+// fills the buffer with len random bytes, eight at a time; they are
+// taken least significant first, so the same on every machine
+void prng_fill(struct prng* prng, u8* out, u32 len)
+{
+	u64 x = 0;
+
+	for (u32 i = 0; i < len; ++i)
+	{
+		if ((i % 8) == 0)
+		{
+			x = prng_next64(prng);
+		}
+
+		out[i] = x & 0xFF;
+		x >>= 8;
+	}
+}
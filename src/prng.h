@@ -0,0 +1,15 @@
+#ifndef H_LY_PRNG
+#define H_LY_PRNG
+
+#include "ctypes.h"
+
+struct prng
+{
+	u64 state;
+};
+
+void prng_seed(struct prng* prng, u64 seed);
+u32 prng_next(struct prng* prng);
+void prng_fill(struct prng* prng, u8* out, u32 len);
+
+#endif
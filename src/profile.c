@@ -0,0 +1,293 @@
+#include "ctypes.h"
+
+#include "alloc.h"
+#include "config.h"
+#include "profile.h"
+#include "timer.h"
+
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <time.h>
+
+// keys dequeued but not presented yet, extra ones are not traced
+#define PROFILE_KEYS 64
+
+// bucket i counts the values from 2^i to 2^(i+1) - 1,
+// nanoseconds for the durations
+#define PROFILE_BUCKETS 40
+
+struct histogram
+{
+	u64 count;
+	u64 total;
+	u64 max;
+	u64 allocs;
+	u64 frees;
+	u64 buckets[PROFILE_BUCKETS];
+};
+
+static struct histogram histograms[PROFILE_COUNT];
+static u64 keys[PROFILE_KEYS];
+static u8 keys_len = 0;
+static u32 warmup_frames = 0;
+static bool frame_strict = false;
+
+static const char* names[PROFILE_COUNT] =
+{
+	"frame",
+	"status",
+	"step",
+	"draw",
+	"animate",
+	"box",
+	"position_input",
+	"labels",
+	"info_line",
+	"info_bar",
+	"clock",
+	"lock_state",
+	"desktop",
+	"login",
+	"password",
+	"present",
+	"input_batch",
+	"key_latency",
+};
+
+// the greeter clock is virtual while replaying a record
+static u64 profile_clock()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec * NSEC_PER_SEC) + now.tv_nsec;
+}
+
+// the allocations are counted like the durations, the frame
+// including the ones of its phases
+void profile_begin(enum profile_phases phase, struct profile_mark* mark)
+{
+	if (!config.profile)
+	{
+		return;
+	}
+
+	// past the warm-up the frames must reuse what they allocated before
+	if ((phase == PROFILE_FRAME) && (config.profile_alloc_warmup > 0))
+	{
+		if (warmup_frames < config.profile_alloc_warmup)
+		{
+			++warmup_frames;
+		}
+		else
+		{
+			frame_strict = true;
+			alloc_forbid(true);
+		}
+	}
+
+	mark->allocs = alloc_count();
+	mark->frees = free_count();
+	mark->time = profile_clock();
+}
+
+void profile_end(enum profile_phases phase, struct profile_mark* mark)
+{
+	if (!config.profile)
+	{
+		return;
+	}
+
+	profile_record(phase, profile_clock() - mark->time);
+	histograms[phase].allocs += alloc_count() - mark->allocs;
+	histograms[phase].frees += free_count() - mark->frees;
+
+	if (phase == PROFILE_FRAME)
+	{
+		frame_strict = false;
+		alloc_forbid(false);
+	}
+}
+
+void profile_record(enum profile_phases phase, u64 value)
+{
+	if (!config.profile)
+	{
+		return;
+	}
+
+	struct histogram* histogram = &histograms[phase];
+	u8 bucket = 0;
+
+	if (value > 0)
+	{
+		bucket = 63 - __builtin_clzll(value);
+	}
+
+	if (bucket >= PROFILE_BUCKETS)
+	{
+		bucket = PROFILE_BUCKETS - 1;
+	}
+
+	++histogram->count;
+	++histogram->buckets[bucket];
+	histogram->total += value;
+
+	if (value > histogram->max)
+	{
+		histogram->max = value;
+	}
+}
+
+// stamps a key when it is taken from the input queue
+void profile_key()
+{
+	if (config.profile && (keys_len < PROFILE_KEYS))
+	{
+		keys[keys_len] = profile_clock();
+		++keys_len;
+	}
+}
+
+// called once the frame reflecting the pending keys was presented
+void profile_keys_presented()
+{
+	u64 now = profile_clock();
+
+	for (u8 i = 0; i < keys_len; ++i)
+	{
+		profile_record(PROFILE_KEY_LATENCY, now - keys[i]);
+	}
+
+	keys_len = 0;
+}
+
+// for keys whose effect is not a frame, like starting a session
+void profile_keys_discard()
+{
+	keys_len = 0;
+}
+
+// for the frames expected to allocate, after a resize or a session
+void profile_warmup()
+{
+	warmup_frames = 0;
+}
+
+// upper bound of the bucket holding the given fraction of the samples,
+// capped by the slowest one
+static unsigned long long percentile(struct histogram* histogram, u8 percent)
+{
+	u64 rank = ((histogram->count * percent) + 99) / 100;
+	u64 seen = 0;
+	u8 i;
+
+	for (i = 0; i < PROFILE_BUCKETS; ++i)
+	{
+		seen += histogram->buckets[i];
+
+		if (seen >= rank)
+		{
+			break;
+		}
+	}
+
+	if (i < PROFILE_BUCKETS)
+	{
+		u64 bound = (2ULL << i) - 1;
+
+		if (bound < histogram->max)
+		{
+			return bound;
+		}
+	}
+
+	return histogram->max;
+}
+
+// appends a summary in nanoseconds (in events for the input batches),
+// tagged with the animation since it drives the drawing costs,
+// with the allocations and frees made during each phase in total,
+// followed by the non-empty buckets as lower bound:count pairs
+void profile_dump()
+{
+	if (!config.profile)
+	{
+		return;
+	}
+
+	// the dump may be requested in the middle of a frame
+	alloc_forbid(false);
+
+	FILE* file = fopen(config.profile_file, "a");
+
+	if (file == NULL)
+	{
+		alloc_forbid(frame_strict);
+		return;
+	}
+
+	fprintf(
+		file,
+		"ly profile at %lld, animation %s\n",
+		(long long) time(NULL),
+		config.animate ? config.animation : "none");
+	fprintf(
+		file,
+		"%-16s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+		"phase",
+		"count",
+		"mean",
+		"p50",
+		"p90",
+		"p99",
+		"max",
+		"allocs",
+		"frees");
+
+	for (u8 i = 0; i < PROFILE_COUNT; ++i)
+	{
+		struct histogram* histogram = &histograms[i];
+
+		if (histogram->count == 0)
+		{
+			continue;
+		}
+
+		fprintf(
+			file,
+			"%-16s %10llu %10llu %10llu %10llu %10llu %10llu %10llu %10llu\n",
+			names[i],
+			(unsigned long long) histogram->count,
+			(unsigned long long) (histogram->total / histogram->count),
+			percentile(histogram, 50),
+			percentile(histogram, 90),
+			percentile(histogram, 99),
+			(unsigned long long) histogram->max,
+			(unsigned long long) histogram->allocs,
+			(unsigned long long) histogram->frees);
+
+		fprintf(file, "%-16s", "");
+
+		for (u8 k = 0; k < PROFILE_BUCKETS; ++k)
+		{
+			if (histogram->buckets[k] > 0)
+			{
+				fprintf(
+					file,
+					" %llu:%llu",
+					1ULL << k,
+					(unsigned long long) histogram->buckets[k]);
+			}
+		}
+
+		fprintf(file, "\n");
+	}
+
+	fprintf(file, "\n");
+	fclose(file);
+	alloc_forbid(frame_strict);
+}
+
+#endif
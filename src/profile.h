@@ -0,0 +1,69 @@
+#ifndef H_LY_PROFILE
+#define H_LY_PROFILE
+
+#include "ctypes.h"
+
+enum profile_phases
+{
+	// everything done between two waits for events
+	PROFILE_FRAME,
+	PROFILE_STATUS,
+	PROFILE_STEP,
+	PROFILE_DRAW,
+	PROFILE_ANIMATE,
+	PROFILE_BOX,
+	PROFILE_POSITION_INPUT,
+	PROFILE_LABELS,
+	PROFILE_INFO_LINE,
+	PROFILE_INFO_BAR,
+	PROFILE_CLOCK,
+	PROFILE_LOCK_STATE,
+	PROFILE_DESKTOP,
+	PROFILE_LOGIN,
+	PROFILE_PASSWORD,
+	PROFILE_PRESENT,
+	// events handled before a frame, not a duration
+	PROFILE_INPUT_BATCH,
+	// from a key being dequeued to the end of the frame showing it
+	PROFILE_KEY_LATENCY,
+	PROFILE_COUNT,
+};
+
+// the timings are only compiled in with -DPROFILE,
+// and only recorded when the profile option is set
+#ifdef PROFILE
+struct profile_mark
+{
+	u64 time;
+	u64 allocs;
+	u64 frees;
+};
+
+void profile_begin(enum profile_phases phase, struct profile_mark* mark);
+void profile_end(enum profile_phases phase, struct profile_mark* mark);
+void profile_record(enum profile_phases phase, u64 value);
+void profile_key();
+void profile_keys_presented();
+void profile_keys_discard();
+void profile_warmup();
+void profile_dump();
+
+#define PROFILED(phase, statement) \
+	do \
+	{ \
+		struct profile_mark profile_start; \
+		profile_begin(phase, &profile_start); \
+		statement; \
+		profile_end(phase, &profile_start); \
+	} while (0)
+#else
+#define profile_dump()
+#define profile_record(phase, value) ((void) (value))
+#define profile_key()
+#define profile_keys_presented()
+#define profile_keys_discard()
+#define profile_warmup()
+#define PROFILED(phase, statement) statement
+#endif
+
+#endif
@@ -0,0 +1,325 @@
+#include "dragonfail.h"
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "clock.h"
+#include "record.h"
+#include "status.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// one entry per line, times in nanoseconds since the start:
+// ly-record <version> <seed> <width> <height>
+// E <time> <type> <mod> <key> <ch> <w> <h> <x> <y>
+// C <clock text>
+// S <time> <console_error> <numlock> <capslock> <clock> <battery> <load> <hostname>
+// Q <time>
+
+// the clock is stored as shown, since its text depends on the time
+// zone and locale of the machine; it belongs to the status after it
+#define RECORD_VERSION 2
+#define RECORD_LINE (64 + STATUS_HOSTNAME_LEN)
+
+// written instead of the characters typed in the password
+#define RECORD_SECRET '*'
+
+void record_open(
+	struct record* record,
+	char* path,
+	u64 seed,
+	u16 width,
+	u16 height,
+	u64 now) // throws
+{
+	// root-owned, it must not be left open in the user session, and
+	// only readable by root since it holds the login typed
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+	record->file = (fd >= 0) ? fdopen(fd, "w") : NULL;
+	record->start = now;
+
+	if (record->file == NULL)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+
+		dgn_throw(DGN_RECORD);
+		return;
+	}
+
+	fprintf(
+		record->file,
+		"ly-record %d %llu %u %u\n",
+		RECORD_VERSION,
+		(unsigned long long) seed,
+		width,
+		height);
+}
+
+void record_event(
+	struct record* record,
+	struct tb_event* event,
+	bool secret,
+	u64 now)
+{
+	if (record->file == NULL)
+	{
+		return;
+	}
+
+	u32 ch = event->ch;
+
+	if (secret && (ch != 0))
+	{
+		ch = RECORD_SECRET;
+	}
+
+	fprintf(
+		record->file,
+		"E %llu %u %u %u %lu %ld %ld %ld %ld\n",
+		(unsigned long long) (now - record->start),
+		event->type,
+		event->mod,
+		event->key,
+		(unsigned long) ch,
+		(long) event->w,
+		(long) event->h,
+		(long) event->x,
+		(long) event->y);
+}
+
+void record_status(
+	struct record* record,
+	const struct status* status,
+	u64 now)
+{
+	if (record->file == NULL)
+	{
+		return;
+	}
+
+	fprintf(record->file, "C %s\n", clock_text(status->clock));
+	fprintf(
+		record->file,
+		"S %llu %d %d %d %lld %d %lu %s\n",
+		(unsigned long long) (now - record->start),
+		status->console_error,
+		status->numlock,
+		status->capslock,
+		(long long) status->clock,
+		status->battery,
+		(unsigned long) status->load,
+		status->hostname);
+}
+
+// marks how long the greeter kept running after the last entry
+void record_close(struct record* record, u64 now)
+{
+	if (record->file == NULL)
+	{
+		return;
+	}
+
+	fprintf(
+		record->file,
+		"Q %llu\n",
+		(unsigned long long) (now - record->start));
+	fclose(record->file);
+	record->file = NULL;
+}
+
+void replay_open(struct replay* replay, char* path) // throws
+{
+	unsigned long long seed;
+	unsigned width;
+	unsigned height;
+	int version;
+
+	replay->file = fopen(path, "r");
+	replay->time = 0;
+	replay->clock[0] = '\0';
+
+	if (replay->file == NULL)
+	{
+		dgn_throw(DGN_RECORD);
+		return;
+	}
+
+	int ok = fscanf(
+		replay->file,
+		"ly-record %d %llu %u %u\n",
+		&version,
+		&seed,
+		&width,
+		&height);
+
+	if ((ok != 4) || (version != RECORD_VERSION))
+	{
+		fclose(replay->file);
+		replay->file = NULL;
+		dgn_throw(DGN_RECORD);
+		return;
+	}
+
+	replay->seed = seed;
+	replay->width = width;
+	replay->height = height;
+}
+
+static bool replay_event(struct replay* replay, char* line)
+{
+	struct tb_event* event = &replay->event;
+	unsigned long long time;
+	unsigned type;
+	unsigned mod;
+	unsigned key;
+	unsigned long ch;
+	long w;
+	long h;
+	long x;
+	long y;
+
+	int ok = sscanf(
+		line,
+		"E %llu %u %u %u %lu %ld %ld %ld %ld",
+		&time,
+		&type,
+		&mod,
+		&key,
+		&ch,
+		&w,
+		&h,
+		&x,
+		&y);
+
+	if (ok != 9)
+	{
+		return false;
+	}
+
+	replay->time = time;
+	event->type = type;
+	event->mod = mod;
+	event->key = key;
+	event->ch = ch;
+	event->w = w;
+	event->h = h;
+	event->x = x;
+	event->y = y;
+
+	return true;
+}
+
+static bool replay_status(struct replay* replay, char* line)
+{
+	struct status* status = &replay->status;
+	unsigned long long time;
+	int console_error;
+	int numlock;
+	int capslock;
+	long long clock;
+	int battery;
+	unsigned long load;
+	int hostname = 0;
+
+	int ok = sscanf(
+		line,
+		"S %llu %d %d %d %lld %d %lu %n",
+		&time,
+		&console_error,
+		&numlock,
+		&capslock,
+		&clock,
+		&battery,
+		&load,
+		&hostname);
+
+	if ((ok != 7) || (hostname == 0))
+	{
+		return false;
+	}
+
+	memset(status, 0, sizeof (struct status));
+	replay->time = time;
+	status->console_error = console_error;
+	status->numlock = numlock;
+	status->capslock = capslock;
+	status->clock = clock;
+	status->battery = battery;
+	status->load = load;
+
+	// the hostname may be empty, the newline is not part of it
+	line[strcspn(line, "\n")] = '\0';
+	strncpy(status->hostname, line + hostname, STATUS_HOSTNAME_LEN - 1);
+
+	return true;
+}
+
+// reads the next entry, the end of the record being one as well
+enum replay_entries replay_next(struct replay* replay)
+{
+	char line[RECORD_LINE];
+	unsigned long long time;
+
+	while ((replay->file != NULL)
+		&& (fgets(line, RECORD_LINE, replay->file) != NULL))
+	{
+		switch (line[0])
+		{
+			case 'E':
+			{
+				if (replay_event(replay, line))
+				{
+					return REPLAY_EVENT;
+				}
+
+				break;
+			}
+			case 'S':
+			{
+				if (replay_status(replay, line))
+				{
+					return REPLAY_STATUS;
+				}
+
+				break;
+			}
+			case 'C':
+			{
+				line[strcspn(line, "\n")] = '\0';
+				strncpy(
+					replay->clock,
+					(line[1] == ' ') ? (line + 2) : "",
+					CLOCK_LEN - 1);
+				replay->clock[CLOCK_LEN - 1] = '\0';
+				break;
+			}
+			case 'Q':
+			{
+				if (sscanf(line, "Q %llu", &time) == 1)
+				{
+					replay->time = time;
+				}
+
+				return REPLAY_END;
+			}
+		}
+	}
+
+	// truncated records end with their last entry
+	return REPLAY_END;
+}
+
+void replay_close(struct replay* replay)
+{
+	if (replay->file != NULL)
+	{
+		fclose(replay->file);
+		replay->file = NULL;
+	}
+}
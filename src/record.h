@@ -0,0 +1,63 @@
+#ifndef H_LY_RECORD
+#define H_LY_RECORD
+
+#include "termbox.h"
+#include "ctypes.h"
+
+#include "clock.h"
+#include "status.h"
+
+#include <stdio.h>
+
+enum replay_entries
+{
+	REPLAY_EVENT,
+	REPLAY_STATUS,
+	REPLAY_END,
+};
+
+// the file stays NULL when not recording
+struct record
+{
+	FILE* file;
+	u64 start;
+};
+
+struct replay
+{
+	FILE* file;
+	u64 seed;
+	u16 width;
+	u16 height;
+
+	// last entry read, in nanoseconds since the start of the record
+	u64 time;
+	struct tb_event event;
+	struct status status;
+	// text of the clock, read along with the status
+	char clock[CLOCK_LEN];
+};
+
+void record_open(
+	struct record* record,
+	char* path,
+	u64 seed,
+	u16 width,
+	u16 height,
+	u64 now);
+void record_event(
+	struct record* record,
+	struct tb_event* event,
+	bool secret,
+	u64 now);
+void record_status(
+	struct record* record,
+	const struct status* status,
+	u64 now);
+void record_close(struct record* record, u64 now);
+
+void replay_open(struct replay* replay, char* path);
+enum replay_entries replay_next(struct replay* replay);
+void replay_close(struct replay* replay);
+
+#endif
@@ -0,0 +1,326 @@
+#include "ctypes.h"
+
+#include "config.h"
+#include "status.h"
+#include "timer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__DragonFly__) || defined(__FreeBSD__)
+	#include <sys/kbio.h>
+#else // linux
+	#include <linux/kd.h>
+#endif
+
+// each source refreshes its part of the next snapshot on its own
+// schedule; the snapshot read by the renderer is only replaced when
+// a value actually changed
+
+#define BATTERY_CAPACITY "/sys/class/power_supply/BAT0/capacity"
+
+struct source
+{
+	// in nanoseconds, zero disables the source
+	u64 period;
+	// returns true when the value differs from the snapshot
+	bool (*poll)(struct status_poller* poller, u64 now);
+};
+
+static bool poll_leds(struct status_poller* poller, u64 now)
+{
+	struct status* status = &poller->next;
+	struct status* old = &poller->snapshot;
+
+	// kept open, the lock keys are polled several times per second
+	if (poller->console_fd < 0)
+	{
+		poller->console_fd = open(config.console_dev, O_RDONLY | O_CLOEXEC);
+	}
+
+	status->console_error = poller->console_fd < 0;
+
+	if (status->console_error)
+	{
+		return !old->console_error;
+	}
+
+#if defined(__DragonFly__) || defined(__FreeBSD__)
+	int led = 0;
+	ioctl(poller->console_fd, KDGETLED, &led);
+	status->numlock = led & LED_NUM;
+	status->capslock = led & LED_CAP;
+#else // linux
+	char led = 0;
+	ioctl(poller->console_fd, KDGKBLED, &led);
+	status->numlock = led & K_NUMLOCK;
+	status->capslock = led & K_CAPSLOCK;
+#endif
+
+	return (status->console_error != old->console_error)
+		|| (status->numlock != old->numlock)
+		|| (status->capslock != old->capslock);
+}
+
+// the next poll happens right after the next second starts
+static bool poll_clock(struct status_poller* poller, u64 now)
+{
+	struct timespec real;
+	clock_gettime(CLOCK_REALTIME, &real);
+
+	poller->next.clock = real.tv_sec;
+	poller->timers[STATUS_CLOCK].next = now + (NSEC_PER_SEC - real.tv_nsec);
+
+	return poller->next.clock != poller->snapshot.clock;
+}
+
+static bool poll_hostname(struct status_poller* poller, u64 now)
+{
+	char* hostname = poller->next.hostname;
+
+	if (gethostname(hostname, STATUS_HOSTNAME_LEN - 1) < 0)
+	{
+		hostname[0] = '\0';
+	}
+
+	hostname[STATUS_HOSTNAME_LEN - 1] = '\0';
+
+	return strcmp(hostname, poller->snapshot.hostname) != 0;
+}
+
+static bool poll_battery(struct status_poller* poller, u64 now)
+{
+	FILE* file = fopen(BATTERY_CAPACITY, "r");
+	int capacity;
+
+	poller->next.battery = -1;
+
+	if (file != NULL)
+	{
+		if (fscanf(file, "%d", &capacity) == 1)
+		{
+			poller->next.battery = capacity;
+		}
+
+		fclose(file);
+	}
+
+	return poller->next.battery != poller->snapshot.battery;
+}
+
+static bool poll_load(struct status_poller* poller, u64 now)
+{
+	double load;
+
+	if (getloadavg(&load, 1) == 1)
+	{
+		poller->next.load = load * 100;
+	}
+
+	return poller->next.load != poller->snapshot.load;
+}
+
+// the battery and load slots are not drawn yet, so they stay
+// disabled until a widget gives them a period
+static const struct source sources[STATUS_COUNT] =
+{
+	{NSEC_PER_SEC / 5, poll_leds},
+	{NSEC_PER_SEC, poll_clock},
+	{60 * NSEC_PER_SEC, poll_hostname},
+	{0, poll_battery},
+	{0, poll_load},
+};
+
+// every source is polled once before the first snapshot is published;
+// with a seed nothing is ever polled, the values are all injected
+void status_init(
+	struct status_poller* poller,
+	u64 now,
+	const struct status* seed)
+{
+	memset(&poller->next, 0, sizeof (struct status));
+	poller->next.battery = -1;
+	poller->console_fd = -1;
+	poller->injected = false;
+	poller->idle = false;
+
+	if (seed != NULL)
+	{
+		poller->next = *seed;
+		poller->snapshot = *seed;
+		poller->injected = true;
+		return;
+	}
+
+	for (u8 i = 0; i < STATUS_COUNT; ++i)
+	{
+		timer_init(&poller->timers[i], sources[i].period, now);
+
+		if (sources[i].period != 0)
+		{
+			sources[i].poll(poller, now);
+		}
+	}
+
+	poller->snapshot = poller->next;
+}
+
+void status_free(struct status_poller* poller)
+{
+	if (poller->console_fd >= 0)
+	{
+		close(poller->console_fd);
+		poller->console_fd = -1;
+	}
+}
+
+const struct status* status_snapshot(struct status_poller* poller)
+{
+	return &poller->snapshot;
+}
+
+// mask of the sources whose values differ
+static u32 status_diff(const struct status* a, const struct status* b)
+{
+	u32 changed = 0;
+
+	if ((a->console_error != b->console_error)
+		|| (a->numlock != b->numlock)
+		|| (a->capslock != b->capslock))
+	{
+		changed |= 1 << STATUS_LEDS;
+	}
+
+	if (a->clock != b->clock)
+	{
+		changed |= 1 << STATUS_CLOCK;
+	}
+
+	if (strcmp(a->hostname, b->hostname) != 0)
+	{
+		changed |= 1 << STATUS_HOSTNAME;
+	}
+
+	if (a->battery != b->battery)
+	{
+		changed |= 1 << STATUS_BATTERY;
+	}
+
+	if (a->load != b->load)
+	{
+		changed |= 1 << STATUS_LOAD;
+	}
+
+	return changed;
+}
+
+// polls the sources due by now and returns the mask
+// of those whose values changed, if any
+u32 status_poll(struct status_poller* poller, u64 now)
+{
+	u32 changed = 0;
+
+	if (poller->injected)
+	{
+		changed = status_diff(&poller->next, &poller->snapshot);
+		poller->snapshot = poller->next;
+
+		return changed;
+	}
+
+	for (u8 i = 0; i < STATUS_COUNT; ++i)
+	{
+		const struct source* source = &sources[i];
+
+		if ((source->period == 0)
+			|| (poller->idle && (i == STATUS_LEDS))
+			|| (timer_ticks(&poller->timers[i], now, 1) == 0))
+		{
+			continue;
+		}
+
+		if (source->poll(poller, now))
+		{
+			changed |= 1 << i;
+		}
+
+		if (poller->idle
+			&& (i == STATUS_CLOCK)
+			&& poll_leds(poller, now))
+		{
+			changed |= 1 << STATUS_LEDS;
+		}
+	}
+
+	if (changed != 0)
+	{
+		poller->snapshot = poller->next;
+	}
+
+	return changed;
+}
+
+// makes a source due right away, for values known to have just changed
+void status_refresh(struct status_poller* poller, enum status_sources source)
+{
+	if (sources[source].period != 0)
+	{
+		poller->timers[source].next = 0;
+	}
+}
+
+// replaces the polled values, published by the next status_poll;
+// used to replay the values of a record
+void status_inject(struct status_poller* poller, const struct status* status)
+{
+	poller->next = *status;
+	poller->injected = true;
+}
+
+// an idle greeter only wakes up once a second, for the clock; the
+// usual pace of the leds is restored on the next key
+void status_idle(struct status_poller* poller, bool idle, u64 now)
+{
+	poller->idle = idle;
+
+	if (!idle)
+	{
+		timer_init(
+			&poller->timers[STATUS_LEDS],
+			sources[STATUS_LEDS].period,
+			now);
+	}
+}
+
+int status_timeout(struct status_poller* poller, u64 now)
+{
+	int timeout = -1;
+
+	if (poller->injected)
+	{
+		return timeout;
+	}
+
+	for (u8 i = 0; i < STATUS_COUNT; ++i)
+	{
+		if ((sources[i].period == 0)
+			|| (poller->idle && (i == STATUS_LEDS)))
+		{
+			continue;
+		}
+
+		int source_timeout = timer_timeout(&poller->timers[i], now);
+
+		if ((timeout < 0) || (source_timeout < timeout))
+		{
+			timeout = source_timeout;
+		}
+	}
+
+	return timeout;
+}
@@ -0,0 +1,60 @@
+#ifndef H_LY_STATUS
+#define H_LY_STATUS
+
+#include "ctypes.h"
+
+#include "timer.h"
+
+#include <time.h>
+
+#define STATUS_HOSTNAME_LEN 256
+
+enum status_sources
+{
+	STATUS_LEDS,
+	STATUS_CLOCK,
+	STATUS_HOSTNAME,
+	STATUS_BATTERY,
+	STATUS_LOAD,
+	STATUS_COUNT,
+};
+
+// values published by the poller, read without any system call
+struct status
+{
+	bool console_error;
+	bool numlock;
+	bool capslock;
+	time_t clock;
+	char hostname[STATUS_HOSTNAME_LEN];
+	// percentage, negative without battery
+	i16 battery;
+	// one-minute load average, in hundredths
+	u32 load;
+};
+
+struct status_poller
+{
+	struct status snapshot;
+	struct status next;
+	struct timer timers[STATUS_COUNT];
+	int console_fd;
+	// the sources are no longer polled once a value was injected
+	bool injected;
+	// the leds are then polled along with the clock
+	bool idle;
+};
+
+void status_init(
+	struct status_poller* poller,
+	u64 now,
+	const struct status* seed);
+void status_free(struct status_poller* poller);
+const struct status* status_snapshot(struct status_poller* poller);
+u32 status_poll(struct status_poller* poller, u64 now);
+void status_refresh(struct status_poller* poller, enum status_sources source);
+void status_inject(struct status_poller* poller, const struct status* status);
+void status_idle(struct status_poller* poller, bool idle, u64 now);
+int status_timeout(struct status_poller* poller, u64 now);
+
+#endif
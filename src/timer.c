@@ -0,0 +1,68 @@
+#include "ctypes.h"
+
+#include "timer.h"
+
+#include <time.h>
+
+// set while replaying a record, zero otherwise
+static u64 virtual_now = 0;
+
+// monotonic time in nanoseconds
+u64 time_mono()
+{
+	if (virtual_now != 0)
+	{
+		return virtual_now;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec * NSEC_PER_SEC) + now.tv_nsec;
+}
+
+// replaces the clock until called with zero,
+// the time only moves forward when told to
+void time_virtual(u64 now)
+{
+	virtual_now = now;
+}
+
+void timer_init(struct timer* timer, u64 period, u64 now)
+{
+	timer->period = period;
+	timer->next = now + period;
+}
+
+// consumes the ticks elapsed by now and returns their number;
+// when more than max ticks are late the extra ones are skipped
+u32 timer_ticks(struct timer* timer, u64 now, u32 max)
+{
+	if (now < timer->next)
+	{
+		return 0;
+	}
+
+	u64 ticks = ((now - timer->next) / timer->period) + 1;
+
+	if (ticks > max)
+	{
+		timer->next = now + timer->period;
+		return max;
+	}
+
+	timer->next += ticks * timer->period;
+
+	return ticks;
+}
+
+// milliseconds left before the next tick, rounded up
+int timer_timeout(struct timer* timer, u64 now)
+{
+	if (now >= timer->next)
+	{
+		return 0;
+	}
+
+	return (timer->next - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC;
+}
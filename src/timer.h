@@ -0,0 +1,21 @@
+#ifndef H_LY_TIMER
+#define H_LY_TIMER
+
+#include "ctypes.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+struct timer
+{
+	u64 period;
+	u64 next;
+};
+
+u64 time_mono();
+void time_virtual(u64 now);
+void timer_init(struct timer* timer, u64 period, u64 now);
+u32 timer_ticks(struct timer* timer, u64 now, u32 max);
+int timer_timeout(struct timer* timer, u64 now);
+
+#endif
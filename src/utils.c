@@ -6,17 +6,18 @@
 #include "utils.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 #if defined(__DragonFly__) || defined(__FreeBSD__)
 	#include <sys/consio.h>
 #else // linux
+	#include <linux/tiocl.h>
 	#include <linux/vt.h>
 #endif
 
@@ -146,62 +147,42 @@ void desktop_load(struct desktop* target)
 	}
 }
 
-static char* hostname_backup = NULL;
-
-void hostname(char** out)
+void switch_tty(struct term_buf* buf)
 {
-	if (hostname_backup != NULL)
-	{
-		*out = hostname_backup;
-		return;
-	}
-
-	int maxlen = sysconf(_SC_HOST_NAME_MAX);
-
-	if (maxlen < 0)
-	{
-		maxlen = _POSIX_HOST_NAME_MAX;
-	}
-
-	hostname_backup = malloc(maxlen + 1);
+	FILE* console = fopen(config.console_dev, "w");
 
-	if (hostname_backup == NULL)
+	if (console == NULL)
 	{
-		dgn_throw(DGN_ALLOC);
+		buf->info_line = lang.err_console_dev;
 		return;
 	}
 
-	if (gethostname(hostname_backup, maxlen) < 0)
-	{
-		dgn_throw(DGN_HOSTNAME);
-		return;
-	}
+	int fd = fileno(console);
 
-	hostname_backup[maxlen] = '\0';
-	*out = hostname_backup;
-}
+	ioctl(fd, VT_ACTIVATE, config.tty);
+	ioctl(fd, VT_WAITACTIVE, config.tty);
 
-void free_hostname()
-{
-	free(hostname_backup);
+	fclose(console);
 }
 
-void switch_tty(struct term_buf* buf)
+void blank_console(struct term_buf* buf, bool blank)
 {
-	FILE* console = fopen(config.console_dev, "w");
+#if defined(__linux__)
+	// unlike fopen, does not allocate while the greeter idles
+	int fd = open(config.console_dev, O_WRONLY | O_CLOEXEC);
 
-	if (console == NULL)
+	if (fd < 0)
 	{
 		buf->info_line = lang.err_console_dev;
 		return;
 	}
 
-	int fd = fileno(console);
+	char arg = blank ? TIOCL_BLANKSCREEN : TIOCL_UNBLANKSCREEN;
 
-	ioctl(fd, VT_ACTIVATE, config.tty);
-	ioctl(fd, VT_WAITACTIVE, config.tty);
+	ioctl(fd, TIOCLINUX, &arg);
 
-	fclose(console);
+	close(fd);
+#endif
 }
 
 void save(struct desktop* desktop, struct text* login)
@@ -275,87 +256,3 @@ void load(struct desktop* desktop, struct text* login)
 	fclose(fp);
 	free(line);
 }
-
-void get_time(char* buf) {
-	time_t now;
-	time(&now);
-
-	struct tm* local = localtime(&now);
-
-	char* day;
-	switch(local->tm_wday) {
-		case 0:
-			day = strdup("Sun");
-			break;
-		case 1:
-			day = strdup("Mon");
-			break;
-		case 2:
-			day = strdup("Tue");
-			break;
-		case 3:
-			day = strdup("Wed");
-			break;
-		case 4:
-			day = strdup("Thu");
-			break;
-		case 5:
-			day = strdup("Fri");
-			break;
-		case 6:
-			day = strdup("Sat");
-			break;
-	}
-
-	char* month;
-	switch(local->tm_mon) {
-		case 0:
-			month = strdup("Jan");
-			break;
-		case 1:
-			month = strdup("Feb");
-			break;
-		case 2:
-			month = strdup("Mar");
-			break;
-		case 3:
-			month = strdup("Apr");
-			break;
-		case 4:
-			month = strdup("May");
-			break;
-		case 5:
-			month = strdup("Jun");
-			break;
-		case 6:
-			month = strdup("Jul");
-			break;
-		case 7:
-			month = strdup("Aug");
-			break;
-		case 8:
-			month = strdup("Sep");
-			break;
-		case 9:
-			month = strdup("Oct");
-			break;
-		case 10:
-			month = strdup("Nov");
-			break;
-		case 11:
-			month = strdup("Dec");
-			break;
-	}
-
-	snprintf(
-		buf,
-		25,
-		"%s %d %s %02d %02d:%02d:%02d",
-		day,
-		local->tm_year + 1900,
-		month,
-		local->tm_mday,
-		local->tm_hour,
-		local->tm_min,
-		local->tm_sec);
-}
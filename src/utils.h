@@ -6,11 +6,9 @@
 #include "config.h"
 
 void desktop_load(struct desktop* target);
-void hostname(char** out);
-void free_hostname();
 void switch_tty(struct term_buf* buf);
+void blank_console(struct term_buf* buf, bool blank);
 void save(struct desktop* desktop, struct text* login);
 void load(struct desktop* desktop, struct text* login);
-void get_time(char* buf);
 
 #endif
@@ -0,0 +1,342 @@
+#include "dragonfail.h"
+#include "ctypes.h"
+
+#include "xauth.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// records are a big-endian family followed by four fields, each made
+// of a big-endian length and its bytes: the address, the display
+// number, the name of the authorization protocol and its data
+#define XAUTH_FIELDS 4
+#define XAUTH_FAMILY_LOCAL 256
+#define XAUTH_NAME "MIT-MAGIC-COOKIE-1"
+#define XAUTH_COOKIE_LEN 16
+#define XAUTH_HOST_LEN 256
+#define XAUTH_PATH_LEN 1024
+#define XAUTH_RECORD_LEN (2 + (2 * XAUTH_FIELDS) + XAUTH_HOST_LEN \
+	+ XAUTH_HOST_LEN + (sizeof (XAUTH_NAME) - 1) + XAUTH_COOKIE_LEN)
+
+// same lock files and timings as libXau, so xauth and the X clients
+// respect it: seconds between two attempts, and before breaking a lock
+#define XAUTH_LOCK_RETRIES 5
+#define XAUTH_LOCK_DELAY 1
+#define XAUTH_LOCK_STALE 600
+
+struct xauth_record
+{
+	u16 family;
+	u16 len[XAUTH_FIELDS];
+	const u8* data[XAUTH_FIELDS];
+	size_t size;
+};
+
+static bool xauth_cookie(u8* cookie)
+{
+	size_t len = 0;
+
+	while (len < XAUTH_COOKIE_LEN)
+	{
+		ssize_t ok = getrandom(cookie + len, XAUTH_COOKIE_LEN - len, 0);
+
+		if (ok < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		len += ok;
+	}
+
+	return true;
+}
+
+static size_t xauth_field(u8* buf, const void* data, u16 len)
+{
+	buf[0] = len >> 8;
+	buf[1] = len & 0xFF;
+	memcpy(buf + 2, data, len);
+
+	return 2 + len;
+}
+
+static u16 xauth_u16(const u8* buf)
+{
+	return (buf[0] << 8) | buf[1];
+}
+
+// fails on truncated records, which are dropped like xauth does
+static bool xauth_parse(const u8* buf, size_t len, struct xauth_record* record)
+{
+	size_t pos = 2;
+
+	if (len < pos)
+	{
+		return false;
+	}
+
+	record->family = xauth_u16(buf);
+
+	for (u8 i = 0; i < XAUTH_FIELDS; ++i)
+	{
+		if ((pos + 2) > len)
+		{
+			return false;
+		}
+
+		record->len[i] = xauth_u16(buf + pos);
+		record->data[i] = buf + pos + 2;
+		pos += 2 + record->len[i];
+
+		if (pos > len)
+		{
+			return false;
+		}
+	}
+
+	record->size = pos;
+
+	return true;
+}
+
+static bool xauth_match(
+	struct xauth_record* record,
+	const char* host,
+	const char* number)
+{
+	size_t host_len = strlen(host);
+	size_t number_len = strlen(number);
+
+	return (record->family == XAUTH_FAMILY_LOCAL)
+		&& (record->len[0] == host_len)
+		&& (memcmp(record->data[0], host, host_len) == 0)
+		&& (record->len[1] == number_len)
+		&& (memcmp(record->data[1], number, number_len) == 0);
+}
+
+static bool xauth_write(int fd, const u8* buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t ok = write(fd, buf, len);
+
+		if (ok < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		buf += ok;
+		len -= ok;
+	}
+
+	return true;
+}
+
+// the whole file, or NULL with a zero length when it does not exist;
+// fails rather than returning part of it, which would drop the others
+static bool xauth_read(const char* path, u8** buf, size_t* len)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	*buf = NULL;
+	*len = 0;
+
+	if (fd < 0)
+	{
+		return errno == ENOENT;
+	}
+
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	if (st.st_size == 0)
+	{
+		close(fd);
+		return true;
+	}
+
+	*buf = malloc(st.st_size);
+
+	while ((*buf != NULL) && (*len < (size_t) st.st_size))
+	{
+		ssize_t ok = read(fd, *buf + *len, st.st_size - *len);
+
+		if ((ok < 0) && (errno == EINTR))
+		{
+			continue;
+		}
+
+		// the file shrank since fstat
+		if (ok == 0)
+		{
+			break;
+		}
+
+		if (ok < 0)
+		{
+			free(*buf);
+			*buf = NULL;
+		}
+		else
+		{
+			*len += ok;
+		}
+	}
+
+	close(fd);
+
+	return *buf != NULL;
+}
+
+static bool xauth_lock(const char* creat_name, const char* link_name)
+{
+	struct stat st;
+	int fd;
+
+	for (u8 i = 0; i < XAUTH_LOCK_RETRIES; ++i)
+	{
+		// breaks the locks left by a writer which died
+		if ((stat(creat_name, &st) == 0)
+			&& ((time(NULL) - st.st_ctime) >= XAUTH_LOCK_STALE))
+		{
+			unlink(creat_name);
+			unlink(link_name);
+		}
+
+		fd = open(creat_name, O_WRONLY | O_CREAT | O_EXCL, 0600);
+
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		else if ((errno != EEXIST) && (errno != EACCES))
+		{
+			return false;
+		}
+
+		if (link(creat_name, link_name) == 0)
+		{
+			return true;
+		}
+
+		if ((errno != EEXIST) && (errno != ENOENT))
+		{
+			return false;
+		}
+
+		sleep(XAUTH_LOCK_DELAY);
+	}
+
+	return false;
+}
+
+// adds a new cookie for the local display, replacing the one it had
+void xauth_add(const char* path, const char* number) // throws
+{
+	char host[XAUTH_HOST_LEN];
+	u8 cookie[XAUTH_COOKIE_LEN];
+	u8 record[XAUTH_RECORD_LEN];
+	size_t len = 2;
+
+	if ((gethostname(host, XAUTH_HOST_LEN) != 0)
+		|| (strlen(number) >= XAUTH_HOST_LEN)
+		|| !xauth_cookie(cookie))
+	{
+		dgn_throw(DGN_XAUTH);
+		return;
+	}
+
+	host[XAUTH_HOST_LEN - 1] = '\0';
+
+	record[0] = XAUTH_FAMILY_LOCAL >> 8;
+	record[1] = XAUTH_FAMILY_LOCAL & 0xFF;
+	len += xauth_field(record + len, host, strlen(host));
+	len += xauth_field(record + len, number, strlen(number));
+	len += xauth_field(record + len, XAUTH_NAME, sizeof (XAUTH_NAME) - 1);
+	len += xauth_field(record + len, cookie, XAUTH_COOKIE_LEN);
+
+	char creat_name[XAUTH_PATH_LEN];
+	char link_name[XAUTH_PATH_LEN];
+	char new_name[XAUTH_PATH_LEN];
+
+	snprintf(creat_name, XAUTH_PATH_LEN, "%s-c", path);
+	snprintf(link_name, XAUTH_PATH_LEN, "%s-l", path);
+	snprintf(new_name, XAUTH_PATH_LEN, "%s-n", path);
+
+	if (!xauth_lock(creat_name, link_name))
+	{
+		dgn_throw(DGN_XAUTH);
+		return;
+	}
+
+	// the file is replaced at once, so clients never read half of it
+	size_t old_len;
+	u8* old;
+	bool ok = xauth_read(path, &old, &old_len);
+	int fd = -1;
+
+	if (ok)
+	{
+		unlink(new_name);
+		fd = open(new_name, O_WRONLY | O_CREAT | O_EXCL, 0600);
+		ok = (fd >= 0) && xauth_write(fd, record, len);
+	}
+
+	struct xauth_record entry;
+	size_t pos = 0;
+
+	while (ok
+		&& (old != NULL)
+		&& xauth_parse(old + pos, old_len - pos, &entry))
+	{
+		if (!xauth_match(&entry, host, number))
+		{
+			ok = xauth_write(fd, old + pos, entry.size);
+		}
+
+		pos += entry.size;
+	}
+
+	free(old);
+
+	if (fd >= 0)
+	{
+		ok = (close(fd) == 0) && ok;
+	}
+
+	if (ok)
+	{
+		ok = rename(new_name, path) == 0;
+	}
+
+	if (!ok)
+	{
+		unlink(new_name);
+		dgn_throw(DGN_XAUTH);
+	}
+
+	unlink(creat_name);
+	unlink(link_name);
+}
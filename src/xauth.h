@@ -0,0 +1,6 @@
+#ifndef H_LY_XAUTH
+#define H_LY_XAUTH
+
+void xauth_add(const char* path, const char* number);
+
+#endif